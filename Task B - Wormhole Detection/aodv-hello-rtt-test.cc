@@ -0,0 +1,220 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/test.h"
+#include "ns3/aodv-hello-rtt.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+
+using namespace ns3;
+using namespace aodv;
+
+/**
+ * \ingroup aodv-test
+ * \ingroup tests
+ *
+ * \brief Hello RTT header Test
+ *
+ * A header must come back unchanged from Serialize and Deserialize, both
+ * without echoes and with the full 255, and ignore echoes beyond that.
+ */
+class AodvHelloRttHeaderTestCase : public TestCase
+{
+public:
+  AodvHelloRttHeaderTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AodvHelloRttHeaderTestCase::AodvHelloRttHeaderTestCase ()
+  : TestCase ("Hello RTT header")
+{
+}
+
+void
+AodvHelloRttHeaderTestCase::DoRun (void)
+{
+  HelloRttHeader empty (0xfffffff0);
+  NS_TEST_ASSERT_MSG_EQ (empty.GetSerializedSize (), 5, "header without echoes");
+  Ptr<Packet> p = Create<Packet> ();
+  p->AddHeader (empty);
+  HelloRttHeader h;
+  NS_TEST_ASSERT_MSG_EQ (p->RemoveHeader (h), 5, "header without echoes read back");
+  NS_TEST_ASSERT_MSG_EQ (h.GetTimestamp (), 0xfffffff0, "timestamp read back");
+  NS_TEST_ASSERT_MSG_EQ (h.GetEchoes ().size (), 0, "no echoes read back");
+
+  HelloRttHeader full (7);
+  for (uint32_t k = 0; k < 256; ++k)
+    {
+      full.AddEcho (Ipv4Address (Ipv4Address ("10.0.1.1").Get () + k), 1000 * k);
+    }
+  NS_TEST_ASSERT_MSG_EQ (full.GetEchoes ().size (), 255, "echoes beyond 255 ignored");
+  NS_TEST_ASSERT_MSG_EQ (full.GetSerializedSize (), 5 + 8 * 255, "header with 255 echoes");
+  p = Create<Packet> ();
+  p->AddHeader (full);
+  NS_TEST_ASSERT_MSG_EQ (p->RemoveHeader (h), 5 + 8 * 255, "header with 255 echoes read back");
+  NS_TEST_ASSERT_MSG_EQ (h.GetTimestamp (), 7, "timestamp read back");
+  NS_TEST_ASSERT_MSG_EQ (h.GetEchoes ().size (), 255, "255 echoes read back");
+  for (uint32_t k = 0; k < 255; ++k)
+    {
+      NS_TEST_ASSERT_MSG_EQ (h.GetEchoes ()[k].m_neighbor, full.GetEchoes ()[k].m_neighbor, "echo " << k << " neighbor");
+      NS_TEST_ASSERT_MSG_EQ (h.GetEchoes ()[k].m_timestamp, 1000 * k, "echo " << k << " timestamp");
+    }
+  uint32_t echo = 0;
+  NS_TEST_ASSERT_MSG_EQ (h.FindEcho (Ipv4Address ("10.0.1.255"), echo), true, "echo found");
+  NS_TEST_ASSERT_MSG_EQ (echo, 254000, "echo found for its neighbor");
+  NS_TEST_ASSERT_MSG_EQ (h.FindEcho (Ipv4Address ("10.0.2.0"), echo), false, "dropped echo not found");
+}
+
+/**
+ * \ingroup aodv-test
+ * \ingroup tests
+ *
+ * \brief Hello RTT table Test
+ *
+ * Node A sends a Hello, node B holds A's timestamp for a while and echoes
+ * it in its next Hello: A must measure twice the one-way delay whatever
+ * the hold time, also when the timestamps wrap while B holds A's one or
+ * while the echo is on its way back.
+ */
+class AodvHelloRttTableTestCase : public TestCase
+{
+public:
+  /**
+   * Constructor
+   * \param name the test name
+   * \param start the time A sends its Hello
+   * \param wrap whether A's clock wraps while the echo is on its way back
+   */
+  AodvHelloRttTableTestCase (std::string name, Time start, bool wrap);
+
+private:
+  virtual void DoRun (void);
+
+  /// A sends its Hello
+  void SendA (void);
+  /// B receives A's Hello
+  void ReceiveB (void);
+  /// B sends its Hello with the echo
+  void SendB (void);
+  /// A receives B's Hello and takes the sample
+  void ReceiveA (void);
+
+  Time m_start;         //!< Time A sends its Hello
+  bool m_wrap;          //!< A's clock wraps while the echo is on its way back
+  Time m_delay;         //!< One-way delay
+  Time m_hold;          //!< Time B holds A's timestamp
+  Ipv4Address m_a;      //!< Address of A
+  Ipv4Address m_b;      //!< Address of B
+  HelloRttTable m_tableA;  //!< Table of A
+  HelloRttTable m_tableB;  //!< Table of B
+  HelloRttHeader m_hello;  //!< Hello in flight
+};
+
+AodvHelloRttTableTestCase::AodvHelloRttTableTestCase (std::string name, Time start, bool wrap)
+  : TestCase (name),
+    m_start (start),
+    m_wrap (wrap),
+    m_delay (MilliSeconds (3)),
+    m_hold (MilliSeconds (400)),
+    m_a ("10.0.0.1"),
+    m_b ("10.0.0.2"),
+    m_tableA (Seconds (2)),
+    m_tableB (Seconds (2))
+{
+}
+
+void
+AodvHelloRttTableTestCase::SendA (void)
+{
+  m_hello = HelloRttHeader ();
+  m_tableA.FillHello (m_hello, Simulator::Now ());
+  NS_TEST_ASSERT_MSG_EQ (m_hello.GetEchoes ().size (), 0, "nothing heard yet, nothing to echo");
+  Simulator::Schedule (m_delay, &AodvHelloRttTableTestCase::ReceiveB, this);
+}
+
+void
+AodvHelloRttTableTestCase::ReceiveB (void)
+{
+  Time sample;
+  NS_TEST_ASSERT_MSG_EQ (m_tableB.NotifyHello (m_a, m_b, m_hello, sample), false, "no echo, no sample");
+  Simulator::Schedule (m_hold, &AodvHelloRttTableTestCase::SendB, this);
+}
+
+void
+AodvHelloRttTableTestCase::SendB (void)
+{
+  m_hello = HelloRttHeader ();
+  m_tableB.FillHello (m_hello, Simulator::Now ());
+  uint32_t echo = 0;
+  NS_TEST_ASSERT_MSG_EQ (m_hello.FindEcho (m_a, echo), true, "A's timestamp echoed");
+  NS_TEST_ASSERT_MSG_EQ (echo, HelloRttTable::ToTimestamp (m_start + m_hold), "hold time added to the echo");
+  Simulator::Schedule (m_delay, &AodvHelloRttTableTestCase::ReceiveA, this);
+}
+
+void
+AodvHelloRttTableTestCase::ReceiveA (void)
+{
+  uint32_t echo = 0;
+  m_hello.FindEcho (m_a, echo);
+  NS_TEST_ASSERT_MSG_EQ (HelloRttTable::ToTimestamp (Simulator::Now ()) < echo, m_wrap, "echo taken on the right side of the wrap");
+  Time sample;
+  NS_TEST_ASSERT_MSG_EQ (m_tableA.NotifyHello (m_b, m_a, m_hello, sample), true, "echo gives a sample");
+  NS_TEST_ASSERT_MSG_EQ (sample, Time (2 * m_delay), "sample is twice the one-way delay");
+  NS_TEST_ASSERT_MSG_NE (m_tableA.Lookup (m_b), 0, "estimator created");
+  NS_TEST_ASSERT_MSG_EQ (m_tableA.Lookup (m_b)->GetEstimate (), Time (2 * m_delay), "estimate is the sample");
+  NS_TEST_ASSERT_MSG_EQ (m_tableB.Lookup (m_a), 0, "no sample taken by B");
+}
+
+void
+AodvHelloRttTableTestCase::DoRun (void)
+{
+  Simulator::Schedule (m_start, &AodvHelloRttTableTestCase::SendA, this);
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup aodv-test
+ * \ingroup tests
+ *
+ * \brief AODV Hello RTT TestSuite
+ */
+class AodvHelloRttTestSuite : public TestSuite
+{
+public:
+  AodvHelloRttTestSuite ()
+    : TestSuite ("aodv-hello-rtt", UNIT)
+  {
+    AddTestCase (new AodvHelloRttHeaderTestCase, TestCase::QUICK);
+    AddTestCase (new AodvHelloRttTableTestCase ("Hello RTT table", Seconds (1), false), TestCase::QUICK);
+    // Timestamps wrap 2^32 us after the start; B holds A's timestamp for
+    // 400 ms and the echo takes 3 ms
+    AddTestCase (new AodvHelloRttTableTestCase ("Hello RTT table, wrap during the hold time",
+                                                MicroSeconds (4294967296ULL) - MilliSeconds (200), false),
+                 TestCase::QUICK);
+    AddTestCase (new AodvHelloRttTableTestCase ("Hello RTT table, wrap during the echo",
+                                                MicroSeconds (4294967296ULL) - MilliSeconds (401), true),
+                 TestCase::QUICK);
+  }
+
+};
+
+static AodvHelloRttTestSuite g_aodvHelloRttTestSuite; //!< Static variable for test initialization
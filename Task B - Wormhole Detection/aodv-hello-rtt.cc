@@ -0,0 +1,189 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "aodv-hello-rtt.h"
+#include "ns3/address-utils.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+namespace ns3
+{
+
+  NS_LOG_COMPONENT_DEFINE("AodvHelloRtt");
+
+  namespace aodv
+  {
+    /// Largest number of echoes a Hello carries
+    static const uint32_t MAX_ECHOES = 255;
+
+    NS_OBJECT_ENSURE_REGISTERED(HelloRttHeader);
+
+    HelloRttHeader::HelloRttHeader(uint32_t timestamp)
+        : m_timestamp(timestamp)
+    {
+    }
+
+    TypeId
+    HelloRttHeader::GetTypeId()
+    {
+      static TypeId tid = TypeId("ns3::aodv::HelloRttHeader")
+                              .SetParent<Header>()
+                              .SetGroupName("Aodv")
+                              .AddConstructor<HelloRttHeader>();
+      return tid;
+    }
+
+    TypeId
+    HelloRttHeader::GetInstanceTypeId() const
+    {
+      return GetTypeId();
+    }
+
+    uint32_t
+    HelloRttHeader::GetSerializedSize() const
+    {
+      return 5 + 8 * m_echoes.size();
+    }
+
+    void
+    HelloRttHeader::Serialize(Buffer::Iterator i) const
+    {
+      i.WriteHtonU32(m_timestamp);
+      i.WriteU8(m_echoes.size());
+      for (std::vector<Echo>::const_iterator j = m_echoes.begin(); j != m_echoes.end(); ++j)
+      {
+        WriteTo(i, j->m_neighbor);
+        i.WriteHtonU32(j->m_timestamp);
+      }
+    }
+
+    uint32_t
+    HelloRttHeader::Deserialize(Buffer::Iterator start)
+    {
+      Buffer::Iterator i = start;
+      m_timestamp = i.ReadNtohU32();
+      uint8_t count = i.ReadU8();
+      m_echoes.clear();
+      m_echoes.reserve(count);
+      for (uint8_t k = 0; k < count; ++k)
+      {
+        Echo echo;
+        ReadFrom(i, echo.m_neighbor);
+        echo.m_timestamp = i.ReadNtohU32();
+        m_echoes.push_back(echo);
+      }
+
+      uint32_t dist = i.GetDistanceFrom(start);
+      NS_ASSERT(dist == GetSerializedSize());
+      return dist;
+    }
+
+    void
+    HelloRttHeader::Print(std::ostream &os) const
+    {
+      os << "Timestamp " << m_timestamp << " echoes";
+      for (std::vector<Echo>::const_iterator j = m_echoes.begin(); j != m_echoes.end(); ++j)
+      {
+        os << " " << j->m_neighbor << ":" << j->m_timestamp;
+      }
+    }
+
+    void
+    HelloRttHeader::AddEcho(Ipv4Address neighbor, uint32_t timestamp)
+    {
+      if (m_echoes.size() < MAX_ECHOES)
+      {
+        Echo echo = {neighbor, timestamp};
+        m_echoes.push_back(echo);
+      }
+    }
+
+    bool
+    HelloRttHeader::FindEcho(Ipv4Address neighbor, uint32_t &timestamp) const
+    {
+      for (std::vector<Echo>::const_iterator j = m_echoes.begin(); j != m_echoes.end(); ++j)
+      {
+        if (j->m_neighbor == neighbor)
+        {
+          timestamp = j->m_timestamp;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    HelloRttTable::HelloRttTable(Time holdTime)
+        : m_holdTime(holdTime)
+    {
+    }
+
+    void
+    HelloRttTable::FillHello(HelloRttHeader &header, Time sendTime)
+    {
+      header.SetTimestamp(ToTimestamp(sendTime));
+      Time now = Simulator::Now();
+      std::map<Ipv4Address, Entry>::iterator i = m_neighbors.begin();
+      while (i != m_neighbors.end())
+      {
+        if (now - i->second.m_received > m_holdTime)
+        {
+          m_neighbors.erase(i++);
+          continue;
+        }
+        // Hold time is added here so the neighbor only subtracts
+        header.AddEcho(i->first, i->second.m_timestamp + ToTimestamp(sendTime - i->second.m_received));
+        ++i;
+      }
+    }
+
+    bool
+    HelloRttTable::NotifyHello(Ipv4Address neighbor, Ipv4Address local, HelloRttHeader const &header, Time &sample)
+    {
+      Entry &entry = m_neighbors[neighbor];
+      entry.m_timestamp = header.GetTimestamp();
+      entry.m_received = Simulator::Now();
+
+      uint32_t echo;
+      if (!header.FindEcho(local, echo))
+      {
+        return false;
+      }
+      // Unsigned difference is correct across a timestamp wrap
+      uint32_t rtt = ToTimestamp(Simulator::Now()) - echo;
+      sample = MicroSeconds(rtt);
+      if (entry.m_rtt == 0)
+      {
+        entry.m_rtt = CreateObject<RttMeanDeviation>();
+      }
+      entry.m_rtt->Measurement(sample);
+      NS_LOG_LOGIC("Hello RTT sample " << sample.As(Time::MS) << " from " << neighbor
+                                       << " estimate " << entry.m_rtt->GetEstimate().As(Time::MS));
+      return true;
+    }
+
+    Ptr<RttMeanDeviation>
+    HelloRttTable::Lookup(Ipv4Address neighbor) const
+    {
+      std::map<Ipv4Address, Entry>::const_iterator i = m_neighbors.find(neighbor);
+      if (i == m_neighbors.end())
+      {
+        return 0;
+      }
+      return i->second.m_rtt;
+    }
+
+  } // namespace aodv
+} // namespace ns3
@@ -0,0 +1,207 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef AODV_HELLO_RTT_H
+#define AODV_HELLO_RTT_H
+
+#include "ns3/header.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+#include "ns3/rtt-estimator.h"
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+namespace ns3
+{
+  namespace aodv
+  {
+    /**
+     * \ingroup aodv
+     * \brief Timestamp echo carried after the RREP header of a Hello message
+     *
+      \verbatim
+      0                   1                   2                   3
+      0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+     |                     Timestamp (microseconds)                  |
+     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+     |  Echo Count   |
+     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+     |                       Neighbor IP Address                     |
+     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+     |                Echoed Timestamp (microseconds)                |
+     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+     |                    Additional Neighbors ...                   |
+     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+      \endverbatim
+     *
+     * The echoed timestamp is the last timestamp heard from the neighbor
+     * plus the time it was held here, so the neighbor gets its RTT as the
+     * difference between its clock and the echo. Timestamps wrap every
+     * 2^32 microseconds.
+     */
+    class HelloRttHeader : public Header
+    {
+    public:
+      /// Timestamp echoed back to one neighbor
+      struct Echo
+      {
+        Ipv4Address m_neighbor; ///< neighbor the echo is for
+        uint32_t m_timestamp;   ///< its timestamp plus the hold time here
+      };
+
+      /**
+       * constructor
+       * \param timestamp the send time in microseconds
+       */
+      HelloRttHeader(uint32_t timestamp = 0);
+
+      /**
+       * \brief Get the type ID.
+       * \return the object TypeId
+       */
+      static TypeId GetTypeId();
+      TypeId GetInstanceTypeId() const;
+      uint32_t GetSerializedSize() const;
+      void Serialize(Buffer::Iterator start) const;
+      uint32_t Deserialize(Buffer::Iterator start);
+      void Print(std::ostream &os) const;
+
+      /**
+       * Set the send timestamp
+       * \param timestamp the send time in microseconds
+       */
+      void SetTimestamp(uint32_t timestamp)
+      {
+        m_timestamp = timestamp;
+      }
+      /**
+       * Get the send timestamp
+       * \returns the send time in microseconds
+       */
+      uint32_t GetTimestamp() const
+      {
+        return m_timestamp;
+      }
+      /**
+       * Add an echo, ignored once 255 echoes are held
+       * \param neighbor the neighbor the echo is for
+       * \param timestamp its timestamp plus the hold time here
+       */
+      void AddEcho(Ipv4Address neighbor, uint32_t timestamp);
+      /**
+       * Find the echo for a neighbor
+       * \param neighbor the neighbor address
+       * \param timestamp [out] the echoed timestamp
+       * \returns true if the header holds an echo for the neighbor
+       */
+      bool FindEcho(Ipv4Address neighbor, uint32_t &timestamp) const;
+      /**
+       * Get the echoes
+       * \returns the echoes
+       */
+      std::vector<Echo> const &GetEchoes() const
+      {
+        return m_echoes;
+      }
+
+    private:
+      uint32_t m_timestamp;       ///< send time in microseconds
+      std::vector<Echo> m_echoes; ///< echoes, at most 255
+    };
+
+    /**
+     * \ingroup aodv
+     * \brief Per-neighbor one-hop RTT taken from Hello timestamp echoes
+     *
+     * Every Hello a neighbor sends echoes the last timestamp it heard from
+     * this node, so each Hello interval yields one RTT sample per neighbor
+     * without extra packets. Samples feed one RttMeanDeviation per neighbor.
+     * A neighbor reached through an out-of-band tunnel shows a one-hop RTT
+     * far above what its radio distance allows.
+     */
+    class HelloRttTable
+    {
+    public:
+      /**
+       * constructor
+       * \param holdTime time after which a silent neighbor is forgotten
+       */
+      HelloRttTable(Time holdTime);
+
+      /**
+       * Fill the timestamp and the echoes of an outgoing Hello
+       * \param header the header to fill
+       * \param sendTime the time the Hello will leave this node
+       */
+      void FillHello(HelloRttHeader &header, Time sendTime);
+      /**
+       * Process the timestamp echo of a received Hello
+       * \param neighbor the neighbor that sent the Hello
+       * \param local the local address the Hello was received on
+       * \param header the timestamp echo
+       * \param sample [out] the RTT sample
+       * \returns true if the Hello echoed a timestamp of this node and a sample was taken
+       */
+      bool NotifyHello(Ipv4Address neighbor, Ipv4Address local, HelloRttHeader const &header, Time &sample);
+      /**
+       * Lookup the RTT estimator of a neighbor
+       * \param neighbor the neighbor address
+       * \returns the estimator or 0 if no sample was taken for this neighbor
+       */
+      Ptr<RttMeanDeviation> Lookup(Ipv4Address neighbor) const;
+      /**
+       * Set the hold time
+       * \param holdTime time after which a silent neighbor is forgotten
+       */
+      void SetHoldTime(Time holdTime)
+      {
+        m_holdTime = holdTime;
+      }
+      /// Forget all neighbors
+      void Clear()
+      {
+        m_neighbors.clear();
+      }
+
+      /**
+       * Convert a time to a Hello timestamp
+       * \param t the time
+       * \returns t in microseconds, modulo 2^32
+       */
+      static uint32_t ToTimestamp(Time t)
+      {
+        return static_cast<uint32_t>(t.GetMicroSeconds());
+      }
+
+    private:
+      /// Neighbor state
+      struct Entry
+      {
+        uint32_t m_timestamp;        ///< last timestamp heard from the neighbor
+        Time m_received;             ///< when it was heard
+        Ptr<RttMeanDeviation> m_rtt; ///< RTT estimator, 0 until the first sample
+      };
+
+      std::map<Ipv4Address, Entry> m_neighbors; ///< neighbors heard within the hold time
+      Time m_holdTime;                          ///< hold time of a silent neighbor
+    };
+
+  } // namespace aodv
+} // namespace ns3
+
+#endif /* AODV_HELLO_RTT_H */
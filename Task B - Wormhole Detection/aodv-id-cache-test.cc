@@ -0,0 +1,203 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/test.h"
+#include "ns3/aodv-id-cache.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
+
+using namespace ns3;
+using namespace aodv;
+
+/**
+ * \ingroup aodv-test
+ * \ingroup tests
+ *
+ * \brief Id cache Test
+ *
+ * A pair must be reported as a duplicate while it lives and as new once
+ * it expired, and a full probe window must make room for new ids.
+ */
+class AodvIdCacheTestCase : public TestCase
+{
+public:
+  AodvIdCacheTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /// Cache a pair after the first ones
+  void MakeLate (void);
+  /// Check the cache while the first pairs still live
+  void CheckLive (void);
+  /// Check the cache once the first pairs expired
+  void CheckExpired (void);
+
+  IdCache m_cache;  //!< Cache under test
+};
+
+AodvIdCacheTestCase::AodvIdCacheTestCase ()
+  : TestCase ("Id cache"),
+    m_cache (Seconds (10))
+{
+}
+
+void
+AodvIdCacheTestCase::MakeLate (void)
+{
+  NS_TEST_ASSERT_MSG_EQ (m_cache.IsDuplicate (Ipv4Address ("10.0.0.2"), 4), false, "late pair new");
+}
+
+void
+AodvIdCacheTestCase::CheckLive (void)
+{
+  NS_TEST_ASSERT_MSG_EQ (m_cache.IsDuplicate (Ipv4Address ("10.0.0.1"), 4), true, "pair still lives");
+  NS_TEST_ASSERT_MSG_EQ (m_cache.GetSize (), 3, "three pairs live");
+}
+
+void
+AodvIdCacheTestCase::CheckExpired (void)
+{
+  NS_TEST_ASSERT_MSG_EQ (m_cache.GetSize (), 1, "first pairs expired");
+  NS_TEST_ASSERT_MSG_EQ (m_cache.IsDuplicate (Ipv4Address ("10.0.0.1"), 4), false, "expired pair is new again");
+  NS_TEST_ASSERT_MSG_EQ (m_cache.IsDuplicate (Ipv4Address ("10.0.0.2"), 4), true, "late pair still lives");
+}
+
+void
+AodvIdCacheTestCase::DoRun (void)
+{
+  NS_TEST_ASSERT_MSG_EQ (m_cache.GetCapacity (), 1024, "default capacity");
+  NS_TEST_ASSERT_MSG_EQ (m_cache.IsDuplicate (Ipv4Address ("10.0.0.1"), 4), false, "first pair new");
+  NS_TEST_ASSERT_MSG_EQ (m_cache.IsDuplicate (Ipv4Address ("10.0.0.1"), 4), true, "first pair seen");
+  NS_TEST_ASSERT_MSG_EQ (m_cache.IsDuplicate (Ipv4Address ("10.0.0.1"), 5), false, "other id new");
+  NS_TEST_ASSERT_MSG_EQ (m_cache.IsDuplicate (Ipv4Address ("10.0.0.2"), 5), false, "other origin new");
+  NS_TEST_ASSERT_MSG_EQ (m_cache.GetSize (), 3, "three pairs cached");
+
+  m_cache.SetLifetime (Seconds (15));
+  NS_TEST_ASSERT_MSG_EQ (m_cache.GetLifeTime (), Seconds (15), "lifetime set");
+  Simulator::Schedule (Seconds (5), &AodvIdCacheTestCase::CheckLive, this);
+  Simulator::Schedule (Seconds (8), &AodvIdCacheTestCase::MakeLate, this);
+  Simulator::Schedule (Seconds (11), &AodvIdCacheTestCase::CheckExpired, this);
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  // A cache of one probe window keeps the newest ids
+  IdCache small (Seconds (10), 1);
+  NS_TEST_ASSERT_MSG_EQ (small.GetCapacity (), 16, "capacity rounded up to a probe window");
+  for (uint32_t i = 0; i < 20; ++i)
+    {
+      NS_TEST_ASSERT_MSG_EQ (small.IsDuplicate (Ipv4Address ("10.0.0.1"), i), false, "id " << i << " new");
+    }
+  NS_TEST_ASSERT_MSG_EQ (small.GetSize (), 16, "full cache");
+  NS_TEST_ASSERT_MSG_EQ (small.IsDuplicate (Ipv4Address ("10.0.0.1"), 19), true, "newest id kept");
+}
+
+/**
+ * \ingroup aodv-test
+ * \ingroup tests
+ *
+ * \brief Id cache capacity Test
+ *
+ * With more live ids than slots every new id must still be reported new
+ * and the oldest ones must make room; a cache sized to twice the live ids
+ * must keep them all.
+ */
+class AodvIdCacheCapacityTestCase : public TestCase
+{
+public:
+  AodvIdCacheCapacityTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \brief Add one id to both caches
+   * \param id the id
+   */
+  void Add (uint32_t id);
+  /// Check the caches once all ids are added
+  void Check (void);
+
+  static const uint32_t IDS = 40;  //!< Ids added, all live at the check
+  IdCache m_small;                 //!< Cache of fewer slots than live ids
+  IdCache m_sized;                 //!< Cache of twice the live ids
+};
+
+AodvIdCacheCapacityTestCase::AodvIdCacheCapacityTestCase ()
+  : TestCase ("Id cache capacity"),
+    m_small (Seconds (10), 16),
+    m_sized (Seconds (10))
+{
+}
+
+void
+AodvIdCacheCapacityTestCase::Add (uint32_t id)
+{
+  NS_TEST_ASSERT_MSG_EQ (m_small.IsDuplicate (Ipv4Address ("10.0.0.1"), id), false, "id " << id << " new in the full cache");
+  NS_TEST_ASSERT_MSG_EQ (m_sized.IsDuplicate (Ipv4Address ("10.0.0.1"), id), false, "id " << id << " new in the sized cache");
+}
+
+void
+AodvIdCacheCapacityTestCase::Check (void)
+{
+  NS_TEST_ASSERT_MSG_EQ (m_small.GetSize (), 16, "full cache");
+  for (uint32_t id = IDS - 16; id < IDS; ++id)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_small.IsDuplicate (Ipv4Address ("10.0.0.1"), id), true, "newest id " << id << " kept");
+    }
+  for (uint32_t id = 0; id < IDS; ++id)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_sized.IsDuplicate (Ipv4Address ("10.0.0.1"), id), true, "live id " << id << " kept");
+    }
+  // The price of a full cache: an evicted live id lets its packet through again
+  NS_TEST_ASSERT_MSG_EQ (m_small.IsDuplicate (Ipv4Address ("10.0.0.1"), 0), false, "oldest id evicted");
+}
+
+void
+AodvIdCacheCapacityTestCase::DoRun (void)
+{
+  m_sized.SetCapacity (2 * IDS);
+  NS_TEST_ASSERT_MSG_EQ (m_sized.GetCapacity (), 128, "capacity rounded up to a power of two");
+  for (uint32_t id = 0; id < IDS; ++id)
+    {
+      Simulator::Schedule (MilliSeconds (id), &AodvIdCacheCapacityTestCase::Add, this, id);
+    }
+  Simulator::Schedule (MilliSeconds (IDS), &AodvIdCacheCapacityTestCase::Check, this);
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup aodv-test
+ * \ingroup tests
+ *
+ * \brief AODV id cache TestSuite
+ */
+class AodvIdCacheTestSuite : public TestSuite
+{
+public:
+  AodvIdCacheTestSuite ()
+    : TestSuite ("aodv-id-cache", UNIT)
+  {
+    AddTestCase (new AodvIdCacheTestCase, TestCase::QUICK);
+    AddTestCase (new AodvIdCacheCapacityTestCase, TestCase::QUICK);
+  }
+
+};
+
+static AodvIdCacheTestSuite g_aodvIdCacheTestSuite; //!< Static variable for test initialization
@@ -0,0 +1,126 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2009 IITP RAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Based on
+ *      NS-2 AODV model developed by the CMU/MONARCH group and optimized and
+ *      tuned by Samir Das and Mahesh Marina, University of Cincinnati;
+ *
+ *      AODV-UU implementation by Erik Nordström of Uppsala University
+ *      http://core.it.uu.se/core/index.php/AODV-UU
+ *
+ * Authors: Elena Buchatskaia <borovkovaes@iitp.ru>
+ *          Pavel Boyko <boyko@iitp.ru>
+ */
+#include "aodv-id-cache.h"
+
+namespace ns3
+{
+  namespace aodv
+  {
+    IdCache::IdCache(Time lifetime, uint32_t capacity)
+        : m_lifetime(lifetime)
+    {
+      SetCapacity(capacity);
+    }
+
+    void
+    IdCache::SetCapacity(uint32_t capacity)
+    {
+      uint32_t size = PROBE_WINDOW;
+      while (size < capacity)
+      {
+        size <<= 1;
+      }
+      UniqueId empty = {0, 0, Time::Min()};
+      m_slots.assign(size, empty);
+    }
+
+    uint32_t
+    IdCache::Hash(Ipv4Address addr, uint32_t id) const
+    {
+      uint32_t h = addr.Get() ^ (id * 0x9e3779b1);
+      h ^= h >> 16;
+      h *= 0x85ebca6b;
+      h ^= h >> 13;
+      return h & (m_slots.size() - 1);
+    }
+
+    bool
+    IdCache::IsDuplicate(Ipv4Address addr, uint32_t id)
+    {
+      Time now = Simulator::Now();
+      uint32_t context = addr.Get();
+      uint32_t mask = m_slots.size() - 1;
+      uint32_t slot = Hash(addr, id);
+      UniqueId *victim = 0;
+      for (uint32_t i = 0; i < PROBE_WINDOW; ++i)
+      {
+        UniqueId &u = m_slots[(slot + i) & mask];
+        if (u.m_expire < now)
+        {
+          // Expired or never used: free for a new entry
+          if (victim == 0 || victim->m_expire >= now)
+          {
+            victim = &u;
+          }
+          continue;
+        }
+        if (u.m_context == context && u.m_id == id)
+        {
+          return true;
+        }
+        if (victim == 0 || (victim->m_expire >= now && u.m_expire < victim->m_expire))
+        {
+          victim = &u;
+        }
+      }
+      victim->m_context = context;
+      victim->m_id = id;
+      victim->m_expire = m_lifetime + now;
+      return false;
+    }
+
+    void
+    IdCache::Purge()
+    {
+      Time now = Simulator::Now();
+      for (std::vector<UniqueId>::iterator i = m_slots.begin(); i != m_slots.end(); ++i)
+      {
+        if (i->m_expire < now)
+        {
+          i->m_expire = Time::Min();
+        }
+      }
+    }
+
+    uint32_t
+    IdCache::GetSize()
+    {
+      Time now = Simulator::Now();
+      uint32_t size = 0;
+      for (std::vector<UniqueId>::const_iterator i = m_slots.begin(); i != m_slots.end(); ++i)
+      {
+        if (i->m_expire >= now)
+        {
+          ++size;
+        }
+      }
+      return size;
+    }
+
+  } // namespace aodv
+} // namespace ns3
@@ -62,6 +62,29 @@ namespace ns3
     /// UDP Port for AODV control traffic
     const uint32_t RoutingProtocol::AODV_PORT = 654;
 
+    /// Offsets of the mutable RREQ fields in RoutingProtocol::RreqTemplate::m_bytes (RFC 3561 5.1, after the type byte)
+    enum RreqTemplateOffset
+    {
+      RREQ_ID_OFFSET = 4,
+      RREQ_DST_SEQNO_OFFSET = 12,
+      RREQ_ORIGIN_OFFSET = 16,
+      RREQ_ORIGIN_SEQNO_OFFSET = 20
+    };
+
+    /**
+     * Write a 32 bit value in network order
+     * \param buffer the destination
+     * \param value the value
+     */
+    static void
+    WriteHtonU32(uint8_t *buffer, uint32_t value)
+    {
+      buffer[0] = (value >> 24) & 0xff;
+      buffer[1] = (value >> 16) & 0xff;
+      buffer[2] = (value >> 8) & 0xff;
+      buffer[3] = value & 0xff;
+    }
+
     /**
      * \ingroup aodv
      * \brief Tag used by AODV implementation
@@ -167,20 +190,31 @@ namespace ns3
           m_destinationOnly(false),
           m_gratuitousReply(true),
           m_enableHello(false),
+          m_enableHelloRtt(false),
+          m_enableTimerWheel(false),
+          m_timerWheelGranularity(MilliSeconds(10)),
           m_routingTable(m_deletePeriod),
+          m_routeCache(),
+          m_routeCacheNext(0),
           m_queue(m_maxQueueLen, m_maxQueueTime),
           m_requestId(0),
           m_seqNo(0),
           m_rreqIdCache(m_pathDiscoveryTime),
           m_dpd(m_pathDiscoveryTime),
           m_nb(m_helloInterval),
+          m_rttTable(m_pathDiscoveryTime, 4),
+          m_rttSuspicionFactor(4),
+          m_helloRtt(Time(m_allowedHelloLoss * m_helloInterval)),
+          m_enableQuarantine(false),
+          m_quarantineFilter(),
+          m_drops(),
+          m_dropReportInterval(Seconds(0)),
           m_rreqCount(0),
           m_rerrCount(0),
-          m_htimer(Timer::CANCEL_ON_DESTROY),
-          m_rreqRateLimitTimer(Timer::CANCEL_ON_DESTROY),
-          m_rerrRateLimitTimer(Timer::CANCEL_ON_DESTROY),
+          m_dropReportTimer(Timer::CANCEL_ON_DESTROY),
           m_lastBcastTime(Seconds(0))
     {
+      m_rreqTemplate.m_valid = false;
       m_nb.SetCallback(MakeCallback(&RoutingProtocol::SendRerrWhenBreaksLinkToNextHop, this));
     }
 
@@ -272,6 +306,15 @@ namespace ns3
                                             MakeTimeAccessor(&RoutingProtocol::SetMaxQueueTime,
                                                              &RoutingProtocol::GetMaxQueueTime),
                                             MakeTimeChecker())
+                              .AddAttribute("IdCacheCapacity",
+                                            "Slots of each of the RREQ id and duplicate packet caches, rounded up to a "
+                                            "power of two. Give it at least twice the RREQ ids, or broadcast packets, "
+                                            "a node sees per PathDiscoveryTime: past that a live id can be evicted and "
+                                            "a copy of its packet forwarded again.",
+                                            UintegerValue(1024),
+                                            MakeUintegerAccessor(&RoutingProtocol::SetIdCacheCapacity,
+                                                                 &RoutingProtocol::GetIdCacheCapacity),
+                                            MakeUintegerChecker<uint32_t>())
                               .AddAttribute("AllowedHelloLoss", "Number of hello messages which may be loss for valid link.",
                                             UintegerValue(2),
                                             MakeUintegerAccessor(&RoutingProtocol::m_allowedHelloLoss),
@@ -291,6 +334,25 @@ namespace ns3
                                             MakeBooleanAccessor(&RoutingProtocol::SetHelloEnable,
                                                                 &RoutingProtocol::GetHelloEnable),
                                             MakeBooleanChecker())
+                              .AddAttribute("EnableHelloRtt",
+                                            "Indicates whether hello messages carry a timestamp echo "
+                                            "that gives a one-hop RTT sample per neighbor and hello interval.",
+                                            BooleanValue(false),
+                                            MakeBooleanAccessor(&RoutingProtocol::m_enableHelloRtt),
+                                            MakeBooleanChecker())
+                              .AddAttribute("EnableTimerWheel",
+                                            "Indicates whether the hello and rate limit timers run on a timer wheel "
+                                            "shared by all nodes, which expires the timers of a node that share a "
+                                            "tick of TimerWheelGranularity with one simulator event. The two rate "
+                                            "limit timers always do, which saves a third of the timer events.",
+                                            BooleanValue(false),
+                                            MakeBooleanAccessor(&RoutingProtocol::m_enableTimerWheel),
+                                            MakeBooleanChecker())
+                              .AddAttribute("TimerWheelGranularity",
+                                            "Tick length of the shared timer wheel; timer delays are rounded up to it.",
+                                            TimeValue(MilliSeconds(10)),
+                                            MakeTimeAccessor(&RoutingProtocol::m_timerWheelGranularity),
+                                            MakeTimeChecker())
                               .AddAttribute("EnableBroadcast", "Indicates whether a broadcast data packets forwarding enable.",
                                             BooleanValue(true),
                                             MakeBooleanAccessor(&RoutingProtocol::SetBroadcastEnable,
@@ -334,7 +396,41 @@ namespace ns3
                                             "Indicates the wifi interface of the second end of the Wormhole tunnel",
                                             Ipv4AddressValue("10.0.1.38"),
                                             MakeIpv4AddressAccessor(&RoutingProtocol::SecondEndWifiWormTunnel),
-                                            MakeIpv4AddressChecker());
+                                            MakeIpv4AddressChecker())
+                              .AddAttribute("RttSuspicionFactor",
+                                            "Number of node-wide per-hop RTT mean deviations a neighbor smoothed per-hop RTT "
+                                            "may exceed the node-wide smoothed per-hop RTT by before it is suspected.",
+                                            UintegerValue(4),
+                                            MakeUintegerAccessor(&RoutingProtocol::m_rttSuspicionFactor),
+                                            MakeUintegerChecker<uint32_t>())
+                              .AddTraceSource("WormholeSuspect",
+                                              "A neighbor per-hop RTT exceeded the suspicion bound.",
+                                              MakeTraceSourceAccessor(&RoutingProtocol::m_wormholeSuspectTrace),
+                                              "ns3::aodv::RoutingProtocol::WormholeSuspectTracedCallback")
+                              .AddTraceSource("HelloRtt",
+                                              "A one-hop RTT sample was taken from a Hello timestamp echo.",
+                                              MakeTraceSourceAccessor(&RoutingProtocol::m_helloRttTrace),
+                                              "ns3::aodv::RoutingProtocol::HelloRttTracedCallback")
+                              .AddTraceSource("RouteDiscoveryRtt",
+                                              "A RREP answered a timed RREQ; the sample is the RTT divided by the hop count to the replier.",
+                                              MakeTraceSourceAccessor(&RoutingProtocol::m_discoveryRttTrace),
+                                              "ns3::aodv::RoutingProtocol::RouteDiscoveryRttTracedCallback")
+                              .AddAttribute("EnableQuarantine",
+                                            "Indicates whether a neighbor suspected of being a wormhole end is quarantined "
+                                            "for BlackListTimeout: routes through it are invalidated and rediscovered.",
+                                            BooleanValue(false),
+                                            MakeBooleanAccessor(&RoutingProtocol::m_enableQuarantine),
+                                            MakeBooleanChecker())
+                              .AddAttribute("DropReportInterval",
+                                            "Interval between drop statistics reports on standard output. "
+                                            "Zero reports once, at the end of the run, and only if packets were dropped.",
+                                            TimeValue(Seconds(0)),
+                                            MakeTimeAccessor(&RoutingProtocol::m_dropReportInterval),
+                                            MakeTimeChecker())
+                              .AddTraceSource("Drop",
+                                              "A data packet was dropped by the routing layer.",
+                                              MakeTraceSourceAccessor(&RoutingProtocol::m_dropTrace),
+                                              "ns3::aodv::RoutingProtocol::DropTracedCallback");
       ;
       return tid;
     }
@@ -346,6 +442,12 @@ namespace ns3
       m_queue.SetMaxQueueLen(len);
     }
     void
+    RoutingProtocol::SetIdCacheCapacity(uint32_t capacity)
+    {
+      m_rreqIdCache.SetCapacity(capacity);
+      m_dpd.SetCapacity(capacity);
+    }
+    void
     RoutingProtocol::SetMaxQueueTime(Time t)
     {
       m_maxQueueTime = t;
@@ -359,6 +461,15 @@ namespace ns3
     void
     RoutingProtocol::DoDispose()
     {
+      uint64_t drops = 0;
+      for (uint32_t i = 0; i < DROP_REASON_COUNT; ++i)
+      {
+        drops += m_drops.m_count[i];
+      }
+      if (m_ipv4 != 0 && (drops != 0 || !m_dropReportInterval.IsZero()))
+      {
+        PrintDropStatistics(Create<OutputStreamWrapper>(&std::cout));
+      }
       m_ipv4 = 0;
       for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::iterator iter =
                m_socketAddresses.begin();
@@ -374,6 +485,13 @@ namespace ns3
         iter->first->Close();
       }
       m_socketSubnetBroadcastAddresses.clear();
+      m_socketIndex.clear();
+      m_receiverCache.clear();
+      Simulator::Remove(m_pendingTxEvent);
+      m_pendingTx.clear();
+      m_discoveryRtt.clear();
+      m_quarantine.clear();
+      m_quarantineExpiry = std::priority_queue<QuarantineExpiry, std::vector<QuarantineExpiry>, std::greater<QuarantineExpiry>>();
       Ipv4RoutingProtocol::DoDispose();
     }
 
@@ -389,6 +507,21 @@ namespace ns3
       *stream->GetStream() << std::endl;
     }
 
+    void
+    RoutingProtocol::PrintDropStatistics(Ptr<OutputStreamWrapper> stream, Time::Unit unit) const
+    {
+      static const char *names[DROP_REASON_COUNT] = {"blackhole", "no-route", "duplicate", "ttl-expired", "quarantine"};
+      std::ostream *os = stream->GetStream();
+      *os << "Node: " << m_ipv4->GetObject<Node>()->GetId()
+          << "; Time: " << Now().As(unit)
+          << ", AODV drops:";
+      for (uint32_t i = 0; i < DROP_REASON_COUNT; ++i)
+      {
+        *os << " " << names[i] << " " << m_drops.m_count[i];
+      }
+      *os << std::endl;
+    }
+
     int64_t
     RoutingProtocol::AssignStreams(int64_t stream)
     {
@@ -397,10 +530,100 @@ namespace ns3
       return 1;
     }
 
+    bool
+    RoutingProtocol::GetNeighborRtt(Ipv4Address neighbor, Time &srtt, Time &rttvar) const
+    {
+      NeighborRtt const *entry = m_rttTable.Lookup(neighbor);
+      if (entry == 0)
+      {
+        return false;
+      }
+      srtt = Time::From(entry->m_srtt);
+      rttvar = Time::From(entry->m_rttvar);
+      return true;
+    }
+
+    bool
+    RoutingProtocol::GetHelloRtt(Ipv4Address neighbor, Time &estimate, Time &variation) const
+    {
+      Ptr<RttMeanDeviation> rtt = m_helloRtt.Lookup(neighbor);
+      if (rtt == 0)
+      {
+        return false;
+      }
+      estimate = rtt->GetEstimate();
+      variation = rtt->GetVariation();
+      return true;
+    }
+
+    bool
+    RoutingProtocol::GetRouteDiscoveryRtt(Ipv4Address dst, Time &estimate, Time &variation) const
+    {
+      std::map<Ipv4Address, Ptr<RttMeanDeviation> >::const_iterator i = m_discoveryRtt.find(dst);
+      if (i == m_discoveryRtt.end())
+      {
+        return false;
+      }
+      estimate = i->second->GetEstimate();
+      variation = i->second->GetVariation();
+      return true;
+    }
+
+    bool
+    RoutingProtocol::LookupQuarantine(Ipv4Address neighbor)
+    {
+      PurgeQuarantine();
+      return m_quarantine.find(neighbor) != m_quarantine.end();
+    }
+
+    void
+    RoutingProtocol::PurgeQuarantine()
+    {
+      Time now = Simulator::Now();
+      bool ended = false;
+      while (!m_quarantineExpiry.empty() && m_quarantineExpiry.top().first <= now)
+      {
+        QuarantineExpiry e = m_quarantineExpiry.top();
+        m_quarantineExpiry.pop();
+        std::map<Ipv4Address, Time>::iterator i = m_quarantine.find(e.second);
+        // A refreshed quarantine has a later node of its own
+        if (i != m_quarantine.end() && i->second == e.first)
+        {
+          NS_LOG_LOGIC("Quarantine of " << e.second << " ended");
+          m_quarantine.erase(i);
+          ended = true;
+        }
+      }
+      if (ended)
+      {
+        // Filter bits may be shared, so rebuild rather than clear the ended ones
+        std::fill(m_quarantineFilter, m_quarantineFilter + QUARANTINE_FILTER_BITS / 64, 0);
+        for (std::map<Ipv4Address, Time>::const_iterator i = m_quarantine.begin(); i != m_quarantine.end(); ++i)
+        {
+          uint32_t bit = QuarantineBit(i->first);
+          m_quarantineFilter[bit >> 6] |= uint64_t(1) << (bit & 63);
+        }
+      }
+    }
+
+    void
+    RoutingProtocol::Quarantine(Ipv4Address neighbor)
+    {
+      NS_LOG_FUNCTION(this << neighbor);
+      Time expire = Simulator::Now() + m_blackListTimeout;
+      m_quarantine[neighbor] = expire;
+      m_quarantineExpiry.push(std::make_pair(expire, neighbor));
+      uint32_t bit = QuarantineBit(neighbor);
+      m_quarantineFilter[bit >> 6] |= uint64_t(1) << (bit & 63);
+      // Invalidate the routes through the neighbor and tell the precursors
+      SendRerrWhenBreaksLinkToNextHop(neighbor);
+    }
+
     void
     RoutingProtocol::Start()
     {
       NS_LOG_FUNCTION(this);
+      AttachTimerWheel();
       if (m_enableHello)
       {
         m_nb.ScheduleTimer();
@@ -412,6 +635,13 @@ namespace ns3
       m_rerrRateLimitTimer.SetFunction(&RoutingProtocol::RerrRateLimitTimerExpire,
                                        this);
       m_rerrRateLimitTimer.Schedule(Seconds(1));
+
+      if (m_dropReportInterval.IsStrictlyPositive())
+      {
+        m_dropReportTimer.SetFunction(&RoutingProtocol::DropReportTimerExpire,
+                                      this);
+        m_dropReportTimer.Schedule(m_dropReportInterval);
+      }
     }
 
     Ptr<Ipv4Route>
@@ -434,10 +664,18 @@ namespace ns3
       sockerr = Socket::ERROR_NOTERROR;
       Ptr<Ipv4Route> route;
       Ipv4Address dst = header.GetDestination();
-      RoutingTableEntry rt;
-      if (m_routingTable.LookupValidRoute(dst, rt))
+      RouteCacheEntry *cached = LookupRouteCache(dst);
+      if (cached == 0)
+      {
+        RoutingTableEntry *rt = m_routingTable.LookupRoute(dst);
+        if (rt != 0 && rt->GetFlag() == VALID)
+        {
+          cached = &AddRouteCache(dst, rt);
+        }
+      }
+      if (cached != 0)
       {
-        route = rt.GetRoute();
+        route = cached->m_route->GetRoute();
         NS_ASSERT(route != 0);
         NS_LOG_DEBUG("Exist route to " << route->GetDestination() << " from interface " << route->GetSource());
         if (oif != 0 && route->GetOutputDevice() != oif)
@@ -446,8 +684,7 @@ namespace ns3
           sockerr = Socket::ERROR_NOROUTETOHOST;
           return Ptr<Ipv4Route>();
         }
-        UpdateRouteLifeTime(dst, m_activeRouteTimeout);
-        UpdateRouteLifeTime(route->GetGateway(), m_activeRouteTimeout);
+        RefreshRouteCache(*cached);
         return route;
       }
 
@@ -542,6 +779,7 @@ namespace ns3
             if (m_dpd.IsDuplicate(p, header))
             {
               NS_LOG_DEBUG("Duplicated packet " << p->GetUid() << " from " << origin << ". Drop.");
+              NotifyDrop(p, header, DROP_DUPLICATE);
               return true;
             }
             UpdateRouteLifeTime(origin, m_activeRouteTimeout);
@@ -583,11 +821,13 @@ namespace ns3
               else
               {
                 NS_LOG_DEBUG("No route to forward broadcast. Drop packet " << p->GetUid());
+                NotifyDrop(p, header, DROP_NO_ROUTE);
               }
             }
             else
             {
               NS_LOG_DEBUG("TTL exceeded. Drop packet " << p->GetUid());
+              NotifyDrop(p, header, DROP_TTL_EXPIRED);
             }
             return true;
           }
@@ -597,12 +837,16 @@ namespace ns3
       // Unicast local delivery
       if (m_ipv4->IsDestinationAddress(dst, iif))
       {
-        UpdateRouteLifeTime(origin, m_activeRouteTimeout);
-        RoutingTableEntry toOrigin;
-        if (m_routingTable.LookupValidRoute(origin, toOrigin))
+        RoutingTableEntry *toOrigin = m_routingTable.LookupRoute(origin);
+        if (toOrigin != 0 && toOrigin->GetFlag() == VALID)
         {
-          UpdateRouteLifeTime(toOrigin.GetNextHop(), m_activeRouteTimeout);
-          m_nb.Update(toOrigin.GetNextHop(), m_activeRouteTimeout);
+          ExtendRouteLifeTime(toOrigin, m_activeRouteTimeout);
+          RoutingTableEntry *toPrevHop = m_routingTable.LookupNextHopRoute(toOrigin);
+          if (toPrevHop != 0 && toPrevHop->GetFlag() == VALID)
+          {
+            ExtendRouteLifeTime(toPrevHop, m_activeRouteTimeout);
+          }
+          m_nb.Update(toOrigin->GetNextHop(), m_activeRouteTimeout);
         }
         if (lcb.IsNull() == false)
         {
@@ -611,11 +855,12 @@ namespace ns3
           /**
            * @brief addd by rng70
            */
-          if (EnableWrmAttack)
+          if (!m_wormTunnels.empty())
           { // TODO check and delete
-            if (dst == FirstEndOfWormTunnel || dst == SecondEndOfWormTunnel)
+            const WormTunnelEnd *tunnel = FindWormTunnelByLocal(dst);
+            if (tunnel != 0 && tunnel->m_deliveryInterface >= 0)
             {
-              iif = 1;
+              iif = tunnel->m_deliveryInterface;
             }
           }
           lcb(p, header, iif);
@@ -647,8 +892,6 @@ namespace ns3
       NS_LOG_FUNCTION(this);
       Ipv4Address dst = header.GetDestination();
       Ipv4Address origin = header.GetSource();
-      m_routingTable.Purge();
-      RoutingTableEntry toDst;
       /**
        * @brief code added by rng70
        * @brief check if the node supposed to behave maliciously
@@ -656,18 +899,28 @@ namespace ns3
       if (IsMalicious)
       {
         /* when malicious node receives packet it drops the packet */
-        std::cout << "Launching Attack! Packet dropped" << std::endl;
+        NS_LOG_LOGIC("Launching Attack! Packet " << p->GetUid() << " dropped");
+        NotifyDrop(p, header, DROP_BLACKHOLE);
         return false;
       }
       /**
        * @brief added code ends here
        */
       // TODO check
-      if (m_routingTable.LookupRoute(dst, toDst))
+      RoutingTableEntry *toDst = m_routingTable.LookupRoute(dst);
+      if (toDst != 0)
       {
-        if (toDst.GetFlag() == VALID)
+        if (toDst->GetFlag() == VALID && IsQuarantined(toDst->GetNextHop()))
         {
-          Ptr<Ipv4Route> route = toDst.GetRoute();
+          // Learnt before the quarantine or from the neighbor itself: drop it and rediscover
+          NS_LOG_DEBUG("Drop packet " << p->GetUid() << " because next hop " << toDst->GetNextHop() << " is quarantined.");
+          SendRerrWhenBreaksLinkToNextHop(toDst->GetNextHop());
+          NotifyDrop(p, header, DROP_QUARANTINE);
+          return false;
+        }
+        if (toDst->GetFlag() == VALID)
+        {
+          Ptr<Ipv4Route> route = toDst->GetRoute();
           NS_LOG_LOGIC(route->GetSource() << " forwarding to " << dst << " from " << origin << " packet " << p->GetUid());
 
           /*
@@ -675,37 +928,56 @@ namespace ns3
            *  Lifetime field of the source, destination and the next hop on the
            *  path to the destination is updated to be no less than the current
            *  time plus ActiveRouteTimeout.
+           *  Entries are touched in place; only the origin costs a second lookup,
+           *  the next hop entries are remembered by the entries that use them.
            */
-          UpdateRouteLifeTime(origin, m_activeRouteTimeout);
-          UpdateRouteLifeTime(dst, m_activeRouteTimeout);
-          UpdateRouteLifeTime(route->GetGateway(), m_activeRouteTimeout);
+          RoutingTableEntry *toOrigin = m_routingTable.LookupRoute(origin);
+          if (toOrigin != 0 && toOrigin->GetFlag() == VALID)
+          {
+            ExtendRouteLifeTime(toOrigin, m_activeRouteTimeout);
+          }
+          ExtendRouteLifeTime(toDst, m_activeRouteTimeout);
+          RoutingTableEntry *toNextHop = m_routingTable.LookupNextHopRoute(toDst);
+          if (toNextHop != 0 && toNextHop->GetFlag() == VALID)
+          {
+            ExtendRouteLifeTime(toNextHop, m_activeRouteTimeout);
+          }
           /*
            *  Since the route between each originator and destination pair is expected to be symmetric, the
            *  Active Route Lifetime for the previous hop, along the reverse path back to the IP source, is also updated
            *  to be no less than the current time plus ActiveRouteTimeout
            */
-          RoutingTableEntry toOrigin;
-          m_routingTable.LookupRoute(origin, toOrigin);
-          UpdateRouteLifeTime(toOrigin.GetNextHop(), m_activeRouteTimeout);
+          Ipv4Address prevHop;
+          if (toOrigin != 0)
+          {
+            prevHop = toOrigin->GetNextHop();
+            RoutingTableEntry *toPrevHop = m_routingTable.LookupNextHopRoute(toOrigin);
+            if (toPrevHop != 0 && toPrevHop->GetFlag() == VALID)
+            {
+              ExtendRouteLifeTime(toPrevHop, m_activeRouteTimeout);
+            }
+          }
 
           m_nb.Update(route->GetGateway(), m_activeRouteTimeout);
-          m_nb.Update(toOrigin.GetNextHop(), m_activeRouteTimeout);
+          m_nb.Update(prevHop, m_activeRouteTimeout);
 
           ucb(route, p, header);
           return true;
         }
         else
         {
-          if (toDst.GetValidSeqNo())
+          if (toDst->GetValidSeqNo())
           {
-            SendRerrWhenNoRouteToForward(dst, toDst.GetSeqNo(), origin);
+            SendRerrWhenNoRouteToForward(dst, toDst->GetSeqNo(), origin);
             NS_LOG_DEBUG("Drop packet " << p->GetUid() << " because no route to forward it.");
+            NotifyDrop(p, header, DROP_NO_ROUTE);
             return false;
           }
         }
       }
       NS_LOG_LOGIC("route not found to " << dst << ". Send RERR message.");
       NS_LOG_DEBUG("Drop packet " << p->GetUid() << " because no route to forward it.");
+      NotifyDrop(p, header, DROP_NO_ROUTE);
       SendRerrWhenNoRouteToForward(dst, 0, origin);
       return false;
     }
@@ -736,6 +1008,7 @@ namespace ns3
     RoutingProtocol::NotifyInterfaceUp(uint32_t i)
     {
       NS_LOG_FUNCTION(this << m_ipv4->GetAddress(i, 0).GetLocal());
+      m_receiverCache.clear();
       Ptr<Ipv4L3Protocol> l3 = m_ipv4->GetObject<Ipv4L3Protocol>();
       if (l3->GetNAddresses(i) > 1)
       {
@@ -756,7 +1029,7 @@ namespace ns3
       socket->Bind(InetSocketAddress(iface.GetLocal(), AODV_PORT));
       socket->SetAllowBroadcast(true);
       socket->SetIpRecvTtl(true);
-      m_socketAddresses.insert(std::make_pair(socket, iface));
+      AddSocket(socket, iface, false);
 
       // create also a subnet broadcast socket
       socket = Socket::CreateSocket(GetObject<Node>(),
@@ -767,7 +1040,7 @@ namespace ns3
       socket->Bind(InetSocketAddress(iface.GetBroadcast(), AODV_PORT));
       socket->SetAllowBroadcast(true);
       socket->SetIpRecvTtl(true);
-      m_socketSubnetBroadcastAddresses.insert(std::make_pair(socket, iface));
+      AddSocket(socket, iface, true);
 
       // Add local broadcast record to the routing table
       Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(iface.GetLocal()));
@@ -805,6 +1078,7 @@ namespace ns3
     RoutingProtocol::NotifyInterfaceDown(uint32_t i)
     {
       NS_LOG_FUNCTION(this << m_ipv4->GetAddress(i, 0).GetLocal());
+      m_receiverCache.clear();
 
       // Disable layer 2 link state monitoring (if possible)
       Ptr<Ipv4L3Protocol> l3 = m_ipv4->GetObject<Ipv4L3Protocol>();
@@ -825,19 +1099,20 @@ namespace ns3
       Ptr<Socket> socket = FindSocketWithInterfaceAddress(m_ipv4->GetAddress(i, 0));
       NS_ASSERT(socket);
       socket->Close();
-      m_socketAddresses.erase(socket);
+      RemoveSocket(socket);
 
       // Close socket
       socket = FindSubnetBroadcastSocketWithInterfaceAddress(m_ipv4->GetAddress(i, 0));
       NS_ASSERT(socket);
       socket->Close();
-      m_socketSubnetBroadcastAddresses.erase(socket);
+      RemoveSocket(socket);
 
       if (m_socketAddresses.empty())
       {
         NS_LOG_LOGIC("No aodv interfaces");
         m_htimer.Cancel();
         m_nb.Clear();
+        m_helloRtt.Clear();
         m_routingTable.Clear();
         return;
       }
@@ -848,6 +1123,7 @@ namespace ns3
     RoutingProtocol::NotifyAddAddress(uint32_t i, Ipv4InterfaceAddress address)
     {
       NS_LOG_FUNCTION(this << " interface " << i << " address " << address);
+      m_receiverCache.clear();
       Ptr<Ipv4L3Protocol> l3 = m_ipv4->GetObject<Ipv4L3Protocol>();
       if (!l3->IsUp(i))
       {
@@ -871,7 +1147,7 @@ namespace ns3
           socket->BindToNetDevice(l3->GetNetDevice(i));
           socket->Bind(InetSocketAddress(iface.GetLocal(), AODV_PORT));
           socket->SetAllowBroadcast(true);
-          m_socketAddresses.insert(std::make_pair(socket, iface));
+          AddSocket(socket, iface, false);
 
           // create also a subnet directed broadcast socket
           socket = Socket::CreateSocket(GetObject<Node>(),
@@ -882,7 +1158,7 @@ namespace ns3
           socket->Bind(InetSocketAddress(iface.GetBroadcast(), AODV_PORT));
           socket->SetAllowBroadcast(true);
           socket->SetIpRecvTtl(true);
-          m_socketSubnetBroadcastAddresses.insert(std::make_pair(socket, iface));
+          AddSocket(socket, iface, true);
 
           // Add local broadcast record to the routing table
           Ptr<NetDevice> dev = m_ipv4->GetNetDevice(
@@ -903,18 +1179,19 @@ namespace ns3
     RoutingProtocol::NotifyRemoveAddress(uint32_t i, Ipv4InterfaceAddress address)
     {
       NS_LOG_FUNCTION(this);
+      m_receiverCache.clear();
       Ptr<Socket> socket = FindSocketWithInterfaceAddress(address);
       if (socket)
       {
         m_routingTable.DeleteAllRoutesFromInterface(address);
         socket->Close();
-        m_socketAddresses.erase(socket);
+        RemoveSocket(socket);
 
         Ptr<Socket> unicastSocket = FindSubnetBroadcastSocketWithInterfaceAddress(address);
         if (unicastSocket)
         {
           unicastSocket->Close();
-          m_socketAddresses.erase(unicastSocket);
+          RemoveSocket(unicastSocket);
         }
 
         Ptr<Ipv4L3Protocol> l3 = m_ipv4->GetObject<Ipv4L3Protocol>();
@@ -931,7 +1208,7 @@ namespace ns3
           socket->Bind(InetSocketAddress(iface.GetLocal(), AODV_PORT));
           socket->SetAllowBroadcast(true);
           socket->SetIpRecvTtl(true);
-          m_socketAddresses.insert(std::make_pair(socket, iface));
+          AddSocket(socket, iface, false);
 
           // create also a unicast socket
           socket = Socket::CreateSocket(GetObject<Node>(),
@@ -942,7 +1219,7 @@ namespace ns3
           socket->Bind(InetSocketAddress(iface.GetBroadcast(), AODV_PORT));
           socket->SetAllowBroadcast(true);
           socket->SetIpRecvTtl(true);
-          m_socketSubnetBroadcastAddresses.insert(std::make_pair(socket, iface));
+          AddSocket(socket, iface, true);
 
           // Add local broadcast record to the routing table
           Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(iface.GetLocal()));
@@ -955,6 +1232,7 @@ namespace ns3
           NS_LOG_LOGIC("No aodv interfaces");
           m_htimer.Cancel();
           m_nb.Clear();
+          m_helloRtt.Clear();
           m_routingTable.Clear();
           return;
         }
@@ -1049,18 +1327,19 @@ namespace ns3
       RreqHeader rreqHeader;
       rreqHeader.SetDst(dst);
 
-      RoutingTableEntry rt;
+      bool added;
+      RoutingTableEntry *rt = m_routingTable.AddOrLookupRoute(dst, added);
       // Using the Hop field in Routing Table to manage the expanding ring search
       uint16_t ttl = m_ttlStart;
-      if (m_routingTable.LookupRoute(dst, rt))
+      if (!added)
       {
-        if (rt.GetFlag() != IN_SEARCH)
+        if (rt->GetFlag() != IN_SEARCH)
         {
-          ttl = std::min<uint16_t>(rt.GetHop() + m_ttlIncrement, m_netDiameter);
+          ttl = std::min<uint16_t>(rt->GetHop() + m_ttlIncrement, m_netDiameter);
         }
         else
         {
-          ttl = rt.GetHop() + m_ttlIncrement;
+          ttl = rt->GetHop() + m_ttlIncrement;
           if (ttl > m_ttlThreshold)
           {
             ttl = m_netDiameter;
@@ -1068,36 +1347,35 @@ namespace ns3
         }
         if (ttl == m_netDiameter)
         {
-          rt.IncrementRreqCnt();
+          rt->IncrementRreqCnt();
         }
-        if (rt.GetValidSeqNo())
+        if (rt->GetValidSeqNo())
         {
-          rreqHeader.SetDstSeqno(rt.GetSeqNo());
+          rreqHeader.SetDstSeqno(rt->GetSeqNo());
         }
         else
         {
           rreqHeader.SetUnknownSeqno(true);
         }
-        rt.SetHop(ttl);
-        rt.SetFlag(IN_SEARCH);
-        rt.SetLifeTime(m_pathDiscoveryTime);
-        m_routingTable.Update(rt);
+        rt->SetHop(ttl);
+        rt->SetFlag(IN_SEARCH);
+        rt->SetLifeTime(m_pathDiscoveryTime);
       }
       else
       {
         rreqHeader.SetUnknownSeqno(true);
         Ptr<NetDevice> dev = 0;
-        RoutingTableEntry newEntry(/*device=*/dev, /*dst=*/dst, /*validSeqNo=*/false, /*seqno=*/0,
-                                   /*iface=*/Ipv4InterfaceAddress(), /*hop=*/ttl,
-                                   /*nextHop=*/Ipv4Address(), /*lifeTime=*/m_pathDiscoveryTime);
+        *rt = RoutingTableEntry(/*device=*/dev, /*dst=*/dst, /*validSeqNo=*/false, /*seqno=*/0,
+                                /*iface=*/Ipv4InterfaceAddress(), /*hop=*/ttl,
+                                /*nextHop=*/Ipv4Address(), /*lifeTime=*/m_pathDiscoveryTime);
         // Check if TtlStart == NetDiameter
         if (ttl == m_netDiameter)
         {
-          newEntry.IncrementRreqCnt();
+          rt->IncrementRreqCnt();
         }
-        newEntry.SetFlag(IN_SEARCH);
-        m_routingTable.AddRoute(newEntry);
+        rt->SetFlag(IN_SEARCH);
       }
+      m_routingTable.Commit(rt);
 
       if (m_gratuitousReply)
       {
@@ -1114,6 +1392,15 @@ namespace ns3
       rreqHeader.SetId(m_requestId);
       rreqHeader.SetHopCount(0); // TODO check if it is necessary
 
+      // Serialize once per discovery; attempts and interfaces only patch the mutable fields
+      PrepareRreqTemplate(rreqHeader);
+      uint8_t *bytes = m_rreqTemplate.m_bytes;
+      WriteHtonU32(bytes + RREQ_ID_OFFSET, m_requestId);
+      WriteHtonU32(bytes + RREQ_DST_SEQNO_OFFSET, rreqHeader.GetDstSeqno());
+      WriteHtonU32(bytes + RREQ_ORIGIN_SEQNO_OFFSET, m_seqNo);
+      SocketIpTtlTag tag;
+      tag.SetTtl(ttl);
+
       // Send RREQ as subnet directed broadcast from each interface used by aodv
       for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator j =
                m_socketAddresses.begin();
@@ -1122,16 +1409,12 @@ namespace ns3
         Ptr<Socket> socket = j->first;
         Ipv4InterfaceAddress iface = j->second;
 
-        rreqHeader.SetOrigin(iface.GetLocal());
         m_rreqIdCache.IsDuplicate(iface.GetLocal(), m_requestId);
+        m_rttTable.NotifyRequestSent(iface.GetLocal(), dst);
 
-        Ptr<Packet> packet = Create<Packet>();
-        SocketIpTtlTag tag;
-        tag.SetTtl(ttl);
+        iface.GetLocal().Serialize(bytes + RREQ_ORIGIN_OFFSET);
+        Ptr<Packet> packet = Create<Packet>(bytes, sizeof(m_rreqTemplate.m_bytes));
         packet->AddPacketTag(tag);
-        packet->AddHeader(rreqHeader);
-        TypeHeader tHeader(AODVTYPE_RREQ);
-        packet->AddHeader(tHeader);
         // Send to all-hosts broadcast if on /32 addr, subnet-directed otherwise
         Ipv4Address destination;
         if (iface.GetMask() == Ipv4Mask::GetOnes())
@@ -1144,16 +1427,71 @@ namespace ns3
         }
         NS_LOG_DEBUG("Send RREQ with id " << rreqHeader.GetId() << " to socket");
         m_lastBcastTime = Simulator::Now();
-        Simulator::Schedule(Time(MilliSeconds(m_uniformRandomVariable->GetInteger(0, 10))), &RoutingProtocol::SendTo, this, socket, packet, destination);
+        ScheduleSendTo(Time(MilliSeconds(m_uniformRandomVariable->GetInteger(0, 10))), socket, packet, destination);
       }
       ScheduleRreqRetry(dst);
     }
 
+    void
+    RoutingProtocol::PrepareRreqTemplate(RreqHeader const &rreqHeader)
+    {
+      RreqTemplate &t = m_rreqTemplate;
+      if (t.m_valid && t.m_dst == rreqHeader.GetDst() && t.m_unknownSeqno == rreqHeader.GetUnknownSeqno() && t.m_gratuitousRrep == rreqHeader.GetGratuitousRrep() && t.m_destinationOnly == rreqHeader.GetDestinationOnly())
+      {
+        return;
+      }
+      NS_LOG_FUNCTION(this << rreqHeader.GetDst());
+      Ptr<Packet> packet = Create<Packet>();
+      packet->AddHeader(rreqHeader);
+      TypeHeader tHeader(AODVTYPE_RREQ);
+      packet->AddHeader(tHeader);
+      NS_ASSERT(packet->GetSize() == sizeof(t.m_bytes));
+      packet->CopyData(t.m_bytes, sizeof(t.m_bytes));
+      t.m_valid = true;
+      t.m_dst = rreqHeader.GetDst();
+      t.m_unknownSeqno = rreqHeader.GetUnknownSeqno();
+      t.m_gratuitousRrep = rreqHeader.GetGratuitousRrep();
+      t.m_destinationOnly = rreqHeader.GetDestinationOnly();
+    }
+
     void
     RoutingProtocol::SendTo(Ptr<Socket> socket, Ptr<Packet> packet, Ipv4Address destination)
     {
       socket->SendTo(packet, 0, InetSocketAddress(destination, AODV_PORT));
     }
+
+    void
+    RoutingProtocol::ScheduleSendTo(Time jitter, Ptr<Socket> socket, Ptr<Packet> packet, Ipv4Address destination)
+    {
+      Time when = Simulator::Now() + jitter;
+      bool earliest = m_pendingTx.empty() || when < m_pendingTx.begin()->first;
+      PendingTx tx = {socket, packet, destination};
+      m_pendingTx.insert(std::make_pair(when, tx));
+      if (earliest)
+      {
+        // Take the later event out of the scheduler rather than leave a cancelled one behind
+        Simulator::Remove(m_pendingTxEvent);
+        m_pendingTxEvent = Simulator::Schedule(jitter, &RoutingProtocol::SendPendingTx, this);
+      }
+    }
+
+    void
+    RoutingProtocol::SendPendingTx()
+    {
+      Time now = Simulator::Now();
+      while (!m_pendingTx.empty() && m_pendingTx.begin()->first <= now)
+      {
+        PendingTx tx = m_pendingTx.begin()->second;
+        m_pendingTx.erase(m_pendingTx.begin());
+        SendTo(tx.m_socket, tx.m_packet, tx.m_destination);
+      }
+      if (!m_pendingTx.empty())
+      {
+        // The event that ran this call is spent, nothing to remove
+        m_pendingTxEvent = Simulator::Schedule(m_pendingTx.begin()->first - now, &RoutingProtocol::SendPendingTx, this);
+      }
+    }
+
     void
     RoutingProtocol::ScheduleRreqRetry(Ipv4Address dst)
     {
@@ -1194,13 +1532,14 @@ namespace ns3
       Ipv4Address sender = inetSourceAddr.GetIpv4();
       Ipv4Address receiver;
 
-      if (m_socketAddresses.find(socket) != m_socketAddresses.end())
+      std::vector<SocketIndexEntry>::const_iterator j = m_socketIndex.begin();
+      while (j != m_socketIndex.end() && j->m_socket != PeekPointer(socket))
       {
-        receiver = m_socketAddresses[socket].GetLocal();
+        ++j;
       }
-      else if (m_socketSubnetBroadcastAddresses.find(socket) != m_socketSubnetBroadcastAddresses.end())
+      if (j != m_socketIndex.end())
       {
-        receiver = m_socketSubnetBroadcastAddresses[socket].GetLocal();
+        receiver = j->m_iface.GetLocal();
       }
       else
       {
@@ -1212,22 +1551,13 @@ namespace ns3
        * @brief code added by rng70
        * //TODO check
        */
-      if (EnableWrmAttack) // CNLAB
+      if (!m_wormTunnels.empty()) // CNLAB
       {
-        // cout <<endl<<"Received AODV Packet at Wormhole Node"<<endl;
-        // cout<<"Sender IP Address-"<<sender<<endl;
-        // cout<<"First End of Wormhole Tunnel"<<FirstEndWifiWormTunnel<<endl;
-        // cout<<"Receiver IP Address-"<<receiver<<endl;
-        // cout<<"Second End of Wifi Tunnel"<<SecondEndWifiWormTunnel;
-        if (sender == FirstEndOfWormTunnel && receiver == SecondEndWifiWormTunnel)
-        {
-          // cout<<"Received by Second Wifi Wrm Tunnel"<<endl;
-          receiver = SecondEndOfWormTunnel;
-        }
-        if (sender == SecondEndOfWormTunnel && receiver == FirstEndWifiWormTunnel)
+        // Packet from the other tunnel end heard on our wifi address
+        const WormTunnelEnd *tunnel = FindWormTunnelByPeer(sender);
+        if (tunnel != 0 && receiver == tunnel->m_localWifi)
         {
-          // cout<<"Received by First Wifi Wrm Tunnel"<<endl;
-          receiver = FirstEndOfWormTunnel;
+          receiver = tunnel->m_local;
         }
       }
 
@@ -1268,49 +1598,130 @@ namespace ns3
     RoutingProtocol::UpdateRouteLifeTime(Ipv4Address addr, Time lifetime)
     {
       NS_LOG_FUNCTION(this << addr << lifetime);
-      RoutingTableEntry rt;
-      if (m_routingTable.LookupRoute(addr, rt))
+      RoutingTableEntry *rt = m_routingTable.LookupRoute(addr);
+      if (rt != 0 && rt->GetFlag() == VALID)
       {
-        if (rt.GetFlag() == VALID)
-        {
-          NS_LOG_DEBUG("Updating VALID route");
-          rt.SetRreqCnt(0);
-          rt.SetLifeTime(std::max(lifetime, rt.GetLifeTime()));
-          m_routingTable.Update(rt);
-          return true;
-        }
+        NS_LOG_DEBUG("Updating VALID route");
+        ExtendRouteLifeTime(rt, lifetime);
+        return true;
       }
       return false;
     }
 
     void
-    RoutingProtocol::UpdateRouteToNeighbor(Ipv4Address sender, Ipv4Address receiver)
+    RoutingProtocol::ExtendRouteLifeTime(RoutingTableEntry *rt, Time lifetime)
     {
-      NS_LOG_FUNCTION(this << "sender " << sender << " receiver " << receiver);
-      RoutingTableEntry toNeighbor;
-      if (!m_routingTable.LookupRoute(sender, toNeighbor))
+      rt->SetRreqCnt(0);
+      rt->Touch(lifetime);
+    }
+
+    RoutingProtocol::RouteCacheEntry *
+    RoutingProtocol::LookupRouteCache(Ipv4Address dst)
+    {
+      for (uint32_t i = 0; i < ROUTE_CACHE_SIZE; ++i)
       {
-        Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver));
-        RoutingTableEntry newEntry(/*device=*/dev, /*dst=*/sender, /*know seqno=*/false, /*seqno=*/0,
-                                   /*iface=*/m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0),
-                                   /*hops=*/1, /*next hop=*/sender, /*lifetime=*/m_activeRouteTimeout);
-        m_routingTable.AddRoute(newEntry);
+        RouteCacheEntry &cached = m_routeCache[i];
+        if (cached.m_route == 0 || cached.m_dst != dst)
+        {
+          continue;
+        }
+        // A route past its lifetime is still VALID until the next purge invalidates it
+        if (cached.m_generation != m_routingTable.GetGeneration() || cached.m_route->GetFlag() != VALID ||
+            cached.m_route->GetLifeTime() < Seconds(0) || cached.m_route->GetNextHop() != cached.m_nextHop)
+        {
+          cached.m_route = 0;
+          return 0;
+        }
+        return &cached;
       }
-      else
+      return 0;
+    }
+
+    RoutingProtocol::RouteCacheEntry &
+    RoutingProtocol::AddRouteCache(Ipv4Address dst, RoutingTableEntry *rt)
+    {
+      RouteCacheEntry *slot = 0;
+      for (uint32_t i = 0; i < ROUTE_CACHE_SIZE && slot == 0; ++i)
       {
-        Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver));
-        if (toNeighbor.GetValidSeqNo() && (toNeighbor.GetHop() == 1) && (toNeighbor.GetOutputDevice() == dev))
+        if (m_routeCache[i].m_route == 0 || m_routeCache[i].m_dst == dst)
         {
-          toNeighbor.SetLifeTime(std::max(m_activeRouteTimeout, toNeighbor.GetLifeTime()));
+          slot = &m_routeCache[i];
         }
-        else
+      }
+      if (slot == 0)
+      {
+        slot = &m_routeCache[m_routeCacheNext];
+        m_routeCacheNext = (m_routeCacheNext + 1) % ROUTE_CACHE_SIZE;
+      }
+      slot->m_dst = dst;
+      slot->m_route = rt;
+      slot->m_nextHop = rt->GetNextHop();
+      // Same instant as the lookup of rt, so this lookup purges nothing
+      slot->m_gateway = m_routingTable.LookupRoute(slot->m_nextHop);
+      slot->m_generation = m_routingTable.GetGeneration();
+      slot->m_refreshed = Time::Min();
+      return *slot;
+    }
+
+    void
+    RoutingProtocol::RefreshRouteCache(RouteCacheEntry &cached)
+    {
+      Time now = Simulator::Now();
+      if (cached.m_refreshed == now)
+      {
+        return;
+      }
+      cached.m_refreshed = now;
+      ExtendRouteLifeTime(cached.m_route, m_activeRouteTimeout);
+      if (cached.m_gateway == 0)
+      {
+        return;
+      }
+      if (cached.m_gateway->GetLifeTime() < Seconds(0))
+      {
+        // Past its lifetime but not purged yet: drop the cache entry and let
+        // the purging lookup invalidate the gateway instead of reviving it
+        Ipv4Address nextHop = cached.m_nextHop;
+        cached.m_route = 0;
+        RoutingTableEntry *gateway = m_routingTable.LookupRoute(nextHop);
+        if (gateway != 0 && gateway->GetFlag() == VALID)
         {
-          RoutingTableEntry newEntry(/*device=*/dev, /*dst=*/sender, /*know seqno=*/false, /*seqno=*/0,
-                                     /*iface=*/m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0),
-                                     /*hops=*/1, /*next hop=*/sender, /*lifetime=*/std::max(m_activeRouteTimeout, toNeighbor.GetLifeTime()));
-          m_routingTable.Update(newEntry);
+          ExtendRouteLifeTime(gateway, m_activeRouteTimeout);
         }
+        return;
+      }
+      if (cached.m_gateway->GetFlag() == VALID)
+      {
+        ExtendRouteLifeTime(cached.m_gateway, m_activeRouteTimeout);
+      }
+    }
+
+    void
+    RoutingProtocol::UpdateRouteToNeighbor(Ipv4Address sender, Ipv4Address receiver)
+    {
+      NS_LOG_FUNCTION(this << "sender " << sender << " receiver " << receiver);
+      bool added;
+      RoutingTableEntry *toNeighbor = m_routingTable.AddOrLookupRoute(sender, added);
+      const ReceiverEntry *rx = ResolveReceiver(receiver);
+      Ptr<NetDevice> dev = rx->m_device;
+      if (added)
+      {
+        *toNeighbor = RoutingTableEntry(/*device=*/dev, /*dst=*/sender, /*know seqno=*/false, /*seqno=*/0,
+                                        /*iface=*/rx->m_iface,
+                                        /*hops=*/1, /*next hop=*/sender, /*lifetime=*/m_activeRouteTimeout);
+      }
+      else if (toNeighbor->GetValidSeqNo() && (toNeighbor->GetHop() == 1) && (toNeighbor->GetOutputDevice() == dev))
+      {
+        toNeighbor->SetLifeTime(std::max(m_activeRouteTimeout, toNeighbor->GetLifeTime()));
+      }
+      else
+      {
+        Time lifetime = std::max(m_activeRouteTimeout, toNeighbor->GetLifeTime());
+        *toNeighbor = RoutingTableEntry(/*device=*/dev, /*dst=*/sender, /*know seqno=*/false, /*seqno=*/0,
+                                        /*iface=*/rx->m_iface,
+                                        /*hops=*/1, /*next hop=*/sender, /*lifetime=*/lifetime);
       }
+      m_routingTable.Commit(toNeighbor);
     }
 
     void
@@ -1321,14 +1732,16 @@ namespace ns3
       p->RemoveHeader(rreqHeader);
 
       // A node ignores all RREQs received from any node in its blacklist
-      RoutingTableEntry toPrev;
-      if (m_routingTable.LookupRoute(src, toPrev))
+      RoutingTableEntry const *toPrev = m_routingTable.LookupRoute(src);
+      if (toPrev != 0 && toPrev->IsUnidirectional())
       {
-        if (toPrev.IsUnidirectional())
-        {
-          NS_LOG_DEBUG("Ignoring RREQ from node in blacklist");
-          return;
-        }
+        NS_LOG_DEBUG("Ignoring RREQ from node in blacklist");
+        return;
+      }
+      if (IsQuarantined(src))
+      {
+        NS_LOG_DEBUG("Ignoring RREQ from quarantined neighbor " << src);
+        return;
       }
 
       uint32_t id = rreqHeader.GetId();
@@ -1358,82 +1771,76 @@ namespace ns3
        *  5. the Lifetime is set to be the maximum of (ExistingLifetime, MinimalLifetime), where
        *     MinimalLifetime = current time + 2*NetTraversalTime - 2*HopCount*NodeTraversalTime
        */
-      RoutingTableEntry toOrigin;
-      if (!m_routingTable.LookupRoute(origin, toOrigin))
+      const ReceiverEntry *rx = ResolveReceiver(receiver);
+      bool added;
+      RoutingTableEntry *toOrigin = m_routingTable.AddOrLookupRoute(origin, added);
+      if (added)
       {
-        Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver));
+        Ptr<NetDevice> dev;
 
         /**
          * @brief code added by rng70 //TODO Check
          */
-        if (EnableWrmAttack && (src == FirstEndOfWormTunnel))
-        {
-          // cout<<"ENTER IN THE ATTACK WRM2";
-          dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(SecondEndOfWormTunnel));
-          receiver = SecondEndOfWormTunnel;
-        }
-        else if (EnableWrmAttack && (src == SecondEndOfWormTunnel))
+        const WormTunnelEnd *tunnel = m_wormTunnels.empty() ? 0 : FindWormTunnelByPeer(src);
+        if (tunnel != 0)
         {
-          // cout<<"ENTER IN THE ATTACK WRM1";
-          dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(FirstEndOfWormTunnel));
-          receiver = FirstEndOfWormTunnel;
+          dev = tunnel->m_device;
+          receiver = tunnel->m_local;
+          rx = ResolveReceiver(receiver);
         }
         else
-          dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver));
+          dev = rx->m_device;
 
         // TODO check till this line
 
-        RoutingTableEntry newEntry(/*device=*/dev, /*dst=*/origin, /*validSeno=*/true, /*seqNo=*/rreqHeader.GetOriginSeqno(),
-                                   /*iface=*/m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0), /*hops=*/hop,
-                                   /*nextHop*/ src, /*timeLife=*/Time((2 * m_netTraversalTime - 2 * hop * m_nodeTraversalTime)));
-        m_routingTable.AddRoute(newEntry);
+        *toOrigin = RoutingTableEntry(/*device=*/dev, /*dst=*/origin, /*validSeno=*/true, /*seqNo=*/rreqHeader.GetOriginSeqno(),
+                                      /*iface=*/rx->m_iface, /*hops=*/hop,
+                                      /*nextHop*/ src, /*timeLife=*/Time((2 * m_netTraversalTime - 2 * hop * m_nodeTraversalTime)));
       }
       else
       {
-        if (toOrigin.GetValidSeqNo())
+        if (toOrigin->GetValidSeqNo())
         {
-          if (int32_t(rreqHeader.GetOriginSeqno()) - int32_t(toOrigin.GetSeqNo()) > 0)
+          if (int32_t(rreqHeader.GetOriginSeqno()) - int32_t(toOrigin->GetSeqNo()) > 0)
           {
-            toOrigin.SetSeqNo(rreqHeader.GetOriginSeqno());
+            toOrigin->SetSeqNo(rreqHeader.GetOriginSeqno());
           }
         }
         else
         {
-          toOrigin.SetSeqNo(rreqHeader.GetOriginSeqno());
+          toOrigin->SetSeqNo(rreqHeader.GetOriginSeqno());
         }
-        toOrigin.SetValidSeqNo(true);
-        toOrigin.SetNextHop(src);
-        toOrigin.SetOutputDevice(m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver)));
-        toOrigin.SetInterface(m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0));
-        toOrigin.SetHop(hop);
-        toOrigin.SetLifeTime(std::max(Time(2 * m_netTraversalTime - 2 * hop * m_nodeTraversalTime),
-                                      toOrigin.GetLifeTime()));
-        m_routingTable.Update(toOrigin);
+        toOrigin->SetValidSeqNo(true);
+        toOrigin->SetNextHop(src);
+        toOrigin->SetOutputDevice(rx->m_device);
+        toOrigin->SetInterface(rx->m_iface);
+        toOrigin->SetHop(hop);
+        toOrigin->SetLifeTime(std::max(Time(2 * m_netTraversalTime - 2 * hop * m_nodeTraversalTime),
+                                       toOrigin->GetLifeTime()));
         // m_nb.Update (src, Time (AllowedHelloLoss * HelloInterval));
       }
+      m_routingTable.Commit(toOrigin);
 
-      RoutingTableEntry toNeighbor;
-      if (!m_routingTable.LookupRoute(src, toNeighbor))
+      RoutingTableEntry *toNeighbor = m_routingTable.AddOrLookupRoute(src, added);
+      if (added)
       {
         NS_LOG_DEBUG("Neighbor:" << src << " not found in routing table. Creating an entry");
-        Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver));
-        RoutingTableEntry newEntry(dev, src, false, rreqHeader.GetOriginSeqno(),
-                                   m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0),
-                                   1, src, m_activeRouteTimeout);
-        m_routingTable.AddRoute(newEntry);
+        *toNeighbor = RoutingTableEntry(rx->m_device, src, false, rreqHeader.GetOriginSeqno(),
+                                        rx->m_iface,
+                                        1, src, m_activeRouteTimeout);
       }
       else
       {
-        toNeighbor.SetLifeTime(m_activeRouteTimeout);
-        toNeighbor.SetValidSeqNo(false);
-        toNeighbor.SetSeqNo(rreqHeader.GetOriginSeqno());
-        toNeighbor.SetFlag(VALID);
-        toNeighbor.SetOutputDevice(m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver)));
-        toNeighbor.SetInterface(m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0));
-        toNeighbor.SetHop(1);
-        toNeighbor.SetNextHop(src);
-        m_routingTable.Update(toNeighbor);
+        toNeighbor->SetLifeTime(m_activeRouteTimeout);
+        toNeighbor->SetValidSeqNo(false);
+        toNeighbor->SetSeqNo(rreqHeader.GetOriginSeqno());
+        toNeighbor->SetFlag(VALID);
+        toNeighbor->SetOutputDevice(rx->m_device);
+        toNeighbor->SetInterface(rx->m_iface);
+        toNeighbor->SetHop(1);
+        toNeighbor->SetNextHop(src);
       }
+      m_routingTable.Commit(toNeighbor);
       m_nb.Update(src, Time(m_allowedHelloLoss * m_helloInterval));
 
       NS_LOG_LOGIC(receiver << " receive RREQ with hop count " << static_cast<uint32_t>(rreqHeader.GetHopCount())
@@ -1444,9 +1851,10 @@ namespace ns3
       //  (i)  it is itself the destination,
       if (IsMyOwnAddress(rreqHeader.GetDst()))
       {
-        m_routingTable.LookupRoute(origin, toOrigin);
+        RoutingTableEntry originRoute;
+        m_routingTable.LookupRoute(origin, originRoute);
         NS_LOG_DEBUG("Send reply since I am the destination");
-        SendReply(rreqHeader, toOrigin);
+        SendReply(rreqHeader, originRoute);
         return;
       }
       /*
@@ -1475,7 +1883,8 @@ namespace ns3
         {
           if (IsMalicious || (!rreqHeader.GetDestinationOnly() && toDst.GetFlag() == VALID)) // TODO check
           {
-            m_routingTable.LookupRoute(origin, toOrigin);
+            RoutingTableEntry originRoute;
+            m_routingTable.LookupRoute(origin, originRoute);
 
             // TODO check start here
             /* Code added by Shalini Satre, Wireless Information Networking Group (WiNG), NITK Surathkal for simulating Blackhole Attack
@@ -1486,15 +1895,14 @@ namespace ns3
              */
             if (IsMalicious)
             {
-              Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver));
-              RoutingTableEntry falseToDst(dev, dst, true, rreqHeader.GetDstSeqno() + 100, m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0), 1, dst, m_activeRouteTimeout);
+              RoutingTableEntry falseToDst(rx->m_device, dst, true, rreqHeader.GetDstSeqno() + 100, rx->m_iface, 1, dst, m_activeRouteTimeout);
 
-              SendReplyByIntermediateNode(falseToDst, toOrigin, rreqHeader.GetGratuitousRrep());
+              SendReplyByIntermediateNode(falseToDst, originRoute, rreqHeader.GetGratuitousRrep());
               return;
             }
             /* Code for Blackhole Attack Simulation ends here */
             // TODO check ends here
-            SendReplyByIntermediateNode(toDst, toOrigin, rreqHeader.GetGratuitousRrep());
+            SendReplyByIntermediateNode(toDst, originRoute, rreqHeader.GetGratuitousRrep());
             return;
           }
           rreqHeader.SetDstSeqno(toDst.GetSeqNo());
@@ -1509,6 +1917,8 @@ namespace ns3
         NS_LOG_DEBUG("TTL exceeded. Drop RREQ origin " << src << " destination " << dst);
         return;
       }
+      // Time the rebroadcast so the RREP coming back yields a per-hop RTT sample
+      m_rttTable.NotifyRequestSent(origin, dst);
 
       for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator j =
                m_socketAddresses.begin();
@@ -1534,7 +1944,7 @@ namespace ns3
           destination = iface.GetBroadcast();
         }
         m_lastBcastTime = Simulator::Now();
-        Simulator::Schedule(Time(MilliSeconds(m_uniformRandomVariable->GetInteger(0, 10))), &RoutingProtocol::SendTo, this, socket, packet, destination);
+        ScheduleSendTo(Time(MilliSeconds(m_uniformRandomVariable->GetInteger(0, 10))), socket, packet, destination);
       }
     }
 
@@ -1597,6 +2007,8 @@ namespace ns3
       SocketIpTtlTag tag;
       tag.SetTtl(toOrigin.GetHop());
       packet->AddPacketTag(tag);
+      // Lets the nodes on the way back time only the hops up to here
+      packet->AddHeader(RrepReplierHeader(rrepHeader.GetHopCount()));
       packet->AddHeader(rrepHeader);
       TypeHeader tHeader(AODVTYPE_RREP);
       packet->AddHeader(tHeader);
@@ -1655,13 +2067,65 @@ namespace ns3
       uint8_t hop = rrepHeader.GetHopCount() + 1;
       rrepHeader.SetHopCount(hop);
 
+      if (IsQuarantined(sender))
+      {
+        NS_LOG_DEBUG("Ignoring RREP from quarantined neighbor " << sender);
+        return;
+      }
+
       // If RREP is Hello message
       if (dst == rrepHeader.GetOrigin())
       {
+        if (m_enableHelloRtt && p->GetSize() > 0)
+        {
+          HelloRttHeader rttHeader;
+          p->RemoveHeader(rttHeader);
+          Time sample;
+          if (m_helloRtt.NotifyHello(dst, receiver, rttHeader, sample))
+          {
+            m_helloRttTrace(dst, sample, m_helloRtt.Lookup(dst)->GetEstimate());
+          }
+        }
         ProcessHello(rrepHeader, receiver);
         return;
       }
 
+      // A RREP sent from a route cache only travelled the hops up to its replier
+      bool cached = p->GetSize() > 0;
+      RrepReplierHeader replier;
+      if (cached)
+      {
+        p->RemoveHeader(replier);
+      }
+      uint8_t travelled = hop > replier.GetHops() ? hop - replier.GetHops() : 0;
+
+      // Score the neighbor the RREP came through against the node-wide per-hop RTT
+      Time sample;
+      if (m_rttTable.NotifyReply(rrepHeader.GetOrigin(), dst, sender, travelled, sample))
+      {
+        Ptr<RttMeanDeviation> &dstRtt = m_discoveryRtt[dst];
+        if (dstRtt == 0)
+        {
+          dstRtt = CreateObject<RttMeanDeviation>();
+        }
+        dstRtt->Measurement(sample);
+        m_discoveryRttTrace(dst, sample, dstRtt->GetEstimate());
+
+        NeighborRtt const *nbRtt = m_rttTable.Lookup(sender);
+        if (nbRtt->m_suspect)
+        {
+          NS_LOG_DEBUG("Neighbor " << sender << " per-hop RTT " << Time::From(nbRtt->m_srtt).As(Time::MS)
+                                   << " exceeds node-wide " << m_rttTable.GetSrtt().As(Time::MS)
+                                   << " + " << m_rttSuspicionFactor << " * " << m_rttTable.GetRttvar().As(Time::MS));
+          m_wormholeSuspectTrace(sender, sample, Time::From(nbRtt->m_srtt));
+          if (m_enableQuarantine)
+          {
+            Quarantine(sender);
+            return;
+          }
+        }
+      }
+
       /*
        * If the route table entry to the destination is created or updated, then the following actions occur:
        * -  the route is marked as active,
@@ -1672,45 +2136,51 @@ namespace ns3
        * -  the expiry time is set to the current time plus the value of the Lifetime in the RREP message,
        * -  and the destination sequence number is the Destination Sequence Number in the RREP message.
        */
-      Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver));
-      RoutingTableEntry newEntry(/*device=*/dev, /*dst=*/dst, /*validSeqNo=*/true, /*seqno=*/rrepHeader.GetDstSeqno(),
-                                 /*iface=*/m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0), /*hop=*/hop,
+      const ReceiverEntry *rx = ResolveReceiver(receiver);
+      RoutingTableEntry newEntry(/*device=*/rx->m_device, /*dst=*/dst, /*validSeqNo=*/true, /*seqno=*/rrepHeader.GetDstSeqno(),
+                                 /*iface=*/rx->m_iface, /*hop=*/hop,
                                  /*nextHop=*/sender, /*lifeTime=*/rrepHeader.GetLifeTime());
-      RoutingTableEntry toDst;
-      if (m_routingTable.LookupRoute(dst, toDst))
-      {
-        /*
-         * The existing entry is updated only in the following circumstances:
-         * (i) the sequence number in the routing table is marked as invalid in route table entry.
-         */
-        if (!toDst.GetValidSeqNo())
-        {
-          m_routingTable.Update(newEntry);
-        }
-        // (ii)the Destination Sequence Number in the RREP is greater than the node's copy of the destination sequence number and the known value is valid,
-        else if ((int32_t(rrepHeader.GetDstSeqno()) - int32_t(toDst.GetSeqNo())) > 0)
-        {
-          m_routingTable.Update(newEntry);
-        }
-        else
-        {
-          // (iii) the sequence numbers are the same, but the route is marked as inactive.
-          if ((rrepHeader.GetDstSeqno() == toDst.GetSeqNo()) && (toDst.GetFlag() != VALID))
-          {
-            m_routingTable.Update(newEntry);
-          }
-          // (iv)  the sequence numbers are the same, and the New Hop Count is smaller than the hop count in route table entry.
-          else if ((rrepHeader.GetDstSeqno() == toDst.GetSeqNo()) && (hop < toDst.GetHop()))
-          {
-            m_routingTable.Update(newEntry);
-          }
-        }
-      }
-      else
+      bool added;
+      RoutingTableEntry *toDst = m_routingTable.AddOrLookupRoute(dst, added);
+      bool inSearch = !added && toDst->GetFlag() == IN_SEARCH;
+      bool update = added;
+      if (added)
       {
         // The forward route for this destination is created if it does not already exist.
         NS_LOG_LOGIC("add new route");
-        m_routingTable.AddRoute(newEntry);
+      }
+      /*
+       * The existing entry is updated only in the following circumstances:
+       * (i) the sequence number in the routing table is marked as invalid in route table entry.
+       */
+      else if (!toDst->GetValidSeqNo())
+      {
+        update = true;
+      }
+      // (ii)the Destination Sequence Number in the RREP is greater than the node's copy of the destination sequence number and the known value is valid,
+      else if ((int32_t(rrepHeader.GetDstSeqno()) - int32_t(toDst->GetSeqNo())) > 0)
+      {
+        update = true;
+      }
+      // (iii) the sequence numbers are the same, but the route is marked as inactive.
+      else if ((rrepHeader.GetDstSeqno() == toDst->GetSeqNo()) && (toDst->GetFlag() != VALID))
+      {
+        update = true;
+      }
+      // (iv)  the sequence numbers are the same, and the New Hop Count is smaller than the hop count in route table entry.
+      else if ((rrepHeader.GetDstSeqno() == toDst->GetSeqNo()) && (hop < toDst->GetHop()))
+      {
+        update = true;
+      }
+      // A route we are searching for is always replaced when the RREP is for us
+      if (inSearch && IsMyOwnAddress(rrepHeader.GetOrigin()))
+      {
+        update = true;
+      }
+      if (update)
+      {
+        *toDst = newEntry;
+        m_routingTable.Commit(toDst);
       }
       // Acknowledge receipt of the RREP by sending a RREP-ACK message back
       if (rrepHeader.GetAckRequired())
@@ -1721,44 +2191,42 @@ namespace ns3
       NS_LOG_LOGIC("receiver " << receiver << " origin " << rrepHeader.GetOrigin());
       if (IsMyOwnAddress(rrepHeader.GetOrigin()))
       {
-        if (toDst.GetFlag() == IN_SEARCH)
+        if (inSearch)
         {
-          m_routingTable.Update(newEntry);
           m_addressReqTimer[dst].Cancel();
           m_addressReqTimer.erase(dst);
         }
-        m_routingTable.LookupRoute(dst, toDst);
-        SendPacketFromQueue(dst, toDst.GetRoute());
+        SendPacketFromQueue(dst, toDst->GetRoute());
         return;
       }
 
-      RoutingTableEntry toOrigin;
-      if (!m_routingTable.LookupRoute(rrepHeader.GetOrigin(), toOrigin) || toOrigin.GetFlag() == IN_SEARCH)
+      RoutingTableEntry *toOrigin = m_routingTable.LookupRoute(rrepHeader.GetOrigin());
+      if (toOrigin == 0 || toOrigin->GetFlag() == IN_SEARCH)
       {
         return; // Impossible! drop.
       }
-      toOrigin.SetLifeTime(std::max(m_activeRouteTimeout, toOrigin.GetLifeTime()));
-      m_routingTable.Update(toOrigin);
+      toOrigin->SetLifeTime(std::max(m_activeRouteTimeout, toOrigin->GetLifeTime()));
 
       // Update information about precursors
-      if (m_routingTable.LookupValidRoute(rrepHeader.GetDst(), toDst))
+      if (toDst->GetFlag() == VALID)
       {
-        toDst.InsertPrecursor(toOrigin.GetNextHop());
-        m_routingTable.Update(toDst);
+        toDst->InsertPrecursor(toOrigin->GetNextHop());
 
-        RoutingTableEntry toNextHopToDst;
-        m_routingTable.LookupRoute(toDst.GetNextHop(), toNextHopToDst);
-        toNextHopToDst.InsertPrecursor(toOrigin.GetNextHop());
-        m_routingTable.Update(toNextHopToDst);
+        RoutingTableEntry *toNextHopToDst = m_routingTable.LookupRoute(toDst->GetNextHop());
+        if (toNextHopToDst != 0)
+        {
+          toNextHopToDst->InsertPrecursor(toOrigin->GetNextHop());
+        }
 
-        toOrigin.InsertPrecursor(toDst.GetNextHop());
-        m_routingTable.Update(toOrigin);
+        toOrigin->InsertPrecursor(toDst->GetNextHop());
 
-        RoutingTableEntry toNextHopToOrigin;
-        m_routingTable.LookupRoute(toOrigin.GetNextHop(), toNextHopToOrigin);
-        toNextHopToOrigin.InsertPrecursor(toDst.GetNextHop());
-        m_routingTable.Update(toNextHopToOrigin);
+        RoutingTableEntry *toNextHopToOrigin = m_routingTable.LookupRoute(toOrigin->GetNextHop());
+        if (toNextHopToOrigin != 0)
+        {
+          toNextHopToOrigin->InsertPrecursor(toDst->GetNextHop());
+        }
       }
+      m_routingTable.Commit(toOrigin);
       SocketIpTtlTag tag;
       p->RemovePacketTag(tag);
       if (tag.GetTtl() < 2)
@@ -1771,24 +2239,28 @@ namespace ns3
       SocketIpTtlTag ttl;
       ttl.SetTtl(tag.GetTtl() - 1);
       packet->AddPacketTag(ttl);
+      if (cached)
+      {
+        packet->AddHeader(replier);
+      }
       packet->AddHeader(rrepHeader);
       TypeHeader tHeader(AODVTYPE_RREP);
       packet->AddHeader(tHeader);
-      Ptr<Socket> socket = FindSocketWithInterfaceAddress(toOrigin.GetInterface());
+      Ptr<Socket> socket = FindSocketWithInterfaceAddress(toOrigin->GetInterface());
       NS_ASSERT(socket);
-      socket->SendTo(packet, 0, InetSocketAddress(toOrigin.GetNextHop(), AODV_PORT));
+      socket->SendTo(packet, 0, InetSocketAddress(toOrigin->GetNextHop(), AODV_PORT));
     }
 
     void
     RoutingProtocol::RecvReplyAck(Ipv4Address neighbor)
     {
       NS_LOG_FUNCTION(this);
-      RoutingTableEntry rt;
-      if (m_routingTable.LookupRoute(neighbor, rt))
+      RoutingTableEntry *rt = m_routingTable.LookupRoute(neighbor);
+      if (rt != 0)
       {
-        rt.m_ackTimer.Cancel();
-        rt.SetFlag(VALID);
-        m_routingTable.Update(rt);
+        rt->m_ackTimer.Cancel();
+        rt->SetFlag(VALID);
+        m_routingTable.Commit(rt);
       }
     }
 
@@ -1801,12 +2273,12 @@ namespace ns3
        * SHOULD make sure that it has an active route to the neighbor, and
        * create one if necessary.
        */
+      const ReceiverEntry *rx = ResolveReceiver(receiver);
       RoutingTableEntry toNeighbor;
       if (!m_routingTable.LookupRoute(rrepHeader.GetDst(), toNeighbor))
       {
-        Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver));
-        RoutingTableEntry newEntry(/*device=*/dev, /*dst=*/rrepHeader.GetDst(), /*validSeqNo=*/true, /*seqno=*/rrepHeader.GetDstSeqno(),
-                                   /*iface=*/m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0),
+        RoutingTableEntry newEntry(/*device=*/rx->m_device, /*dst=*/rrepHeader.GetDst(), /*validSeqNo=*/true, /*seqno=*/rrepHeader.GetDstSeqno(),
+                                   /*iface=*/rx->m_iface,
                                    /*hop=*/1, /*nextHop=*/rrepHeader.GetDst(), /*lifeTime=*/rrepHeader.GetLifeTime());
         m_routingTable.AddRoute(newEntry);
       }
@@ -1821,27 +2293,19 @@ namespace ns3
          * @brief code added by rng70
          * //TODO check
          */
-        Ipv4Address wrmDst = rrepHeader.GetDst();
-        if (EnableWrmAttack && wrmDst == FirstEndOfWormTunnel)
+        const WormTunnelEnd *tunnel = m_wormTunnels.empty() ? 0 : FindWormTunnelByPeer(rrepHeader.GetDst());
+        if (tunnel != 0)
         {
-          // cout<<"RREP Helper Contains First End P2P interface Address";
-          toNeighbor.SetOutputDevice(m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(SecondEndOfWormTunnel)));
-          toNeighbor.SetInterface(m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(SecondEndOfWormTunnel), 0));
-          toNeighbor.SetHop(1);
-          toNeighbor.SetNextHop(rrepHeader.GetDst());
-        }
-        else if (EnableWrmAttack && wrmDst == SecondEndOfWormTunnel)
-        {
-          // cout<<"RREP Helper Contains Second End P2P interface Address";
-          toNeighbor.SetOutputDevice(m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(FirstEndOfWormTunnel)));
-          toNeighbor.SetInterface(m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(FirstEndOfWormTunnel), 0));
+          // Hello from the other tunnel end: reach it through the tunnel
+          toNeighbor.SetOutputDevice(tunnel->m_device);
+          toNeighbor.SetInterface(tunnel->m_iface);
           toNeighbor.SetHop(1);
           toNeighbor.SetNextHop(rrepHeader.GetDst());
         }
         else
         {
-          toNeighbor.SetOutputDevice(m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver)));
-          toNeighbor.SetInterface(m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0));
+          toNeighbor.SetOutputDevice(rx->m_device);
+          toNeighbor.SetInterface(rx->m_iface);
           toNeighbor.SetHop(1);
           toNeighbor.SetNextHop(rrepHeader.GetDst());
         }
@@ -1976,6 +2440,21 @@ namespace ns3
       m_lastBcastTime = Time(Seconds(0));
     }
 
+    void
+    RoutingProtocol::AttachTimerWheel()
+    {
+      // Called before the first of the timers is scheduled, from whichever
+      // of DoInitialize and Start runs first
+      if (!m_enableTimerWheel || m_htimer.IsRunning() || m_rreqRateLimitTimer.IsRunning())
+      {
+        return;
+      }
+      Ptr<TimerWheel> wheel = TimerWheel::GetShared(m_timerWheelGranularity);
+      m_htimer.SetWheel(wheel);
+      m_rreqRateLimitTimer.SetWheel(wheel);
+      m_rerrRateLimitTimer.SetWheel(wheel);
+    }
+
     void
     RoutingProtocol::RreqRateLimitTimerExpire()
     {
@@ -1992,6 +2471,14 @@ namespace ns3
       m_rerrRateLimitTimer.Schedule(Seconds(1));
     }
 
+    void
+    RoutingProtocol::DropReportTimerExpire()
+    {
+      NS_LOG_FUNCTION(this);
+      PrintDropStatistics(Create<OutputStreamWrapper>(&std::cout));
+      m_dropReportTimer.Schedule(m_dropReportInterval);
+    }
+
     void
     RoutingProtocol::AckTimerExpire(Ipv4Address neighbor, Time blacklistTimeout)
     {
@@ -2015,10 +2502,18 @@ namespace ns3
         Ipv4InterfaceAddress iface = j->second;
         RrepHeader helloHeader(/*prefix size=*/0, /*hops=*/0, /*dst=*/iface.GetLocal(), /*dst seqno=*/m_seqNo,
                                /*origin=*/iface.GetLocal(), /*lifetime=*/Time(m_allowedHelloLoss * m_helloInterval));
+        // Drawn first so the timestamp echo can carry the actual send time
+        Time jitter = Time(MilliSeconds(m_uniformRandomVariable->GetInteger(0, 10)));
         Ptr<Packet> packet = Create<Packet>();
         SocketIpTtlTag tag;
         tag.SetTtl(1);
         packet->AddPacketTag(tag);
+        if (m_enableHelloRtt)
+        {
+          HelloRttHeader rttHeader;
+          m_helloRtt.FillHello(rttHeader, Simulator::Now() + jitter);
+          packet->AddHeader(rttHeader);
+        }
         packet->AddHeader(helloHeader);
         TypeHeader tHeader(AODVTYPE_RREP);
         packet->AddHeader(tHeader);
@@ -2032,8 +2527,7 @@ namespace ns3
         {
           destination = iface.GetBroadcast();
         }
-        Time jitter = Time(MilliSeconds(m_uniformRandomVariable->GetInteger(0, 10)));
-        Simulator::Schedule(jitter, &RoutingProtocol::SendTo, this, socket, packet, destination);
+        ScheduleSendTo(jitter, socket, packet, destination);
       }
     }
 
@@ -2201,7 +2695,7 @@ namespace ns3
           Ptr<Socket> socket = FindSocketWithInterfaceAddress(toPrecursor.GetInterface());
           NS_ASSERT(socket);
           NS_LOG_LOGIC("one precursor => unicast RERR to " << toPrecursor.GetDestination() << " from " << toPrecursor.GetInterface().GetLocal());
-          Simulator::Schedule(Time(MilliSeconds(m_uniformRandomVariable->GetInteger(0, 10))), &RoutingProtocol::SendTo, this, socket, packet, precursors.front());
+          ScheduleSendTo(Time(MilliSeconds(m_uniformRandomVariable->GetInteger(0, 10))), socket, packet, precursors.front());
           m_rerrCount++;
         }
         return;
@@ -2235,8 +2729,157 @@ namespace ns3
         {
           destination = i->GetBroadcast();
         }
-        Simulator::Schedule(Time(MilliSeconds(m_uniformRandomVariable->GetInteger(0, 10))), &RoutingProtocol::SendTo, this, socket, p, destination);
+        ScheduleSendTo(Time(MilliSeconds(m_uniformRandomVariable->GetInteger(0, 10))), socket, p, destination);
+      }
+    }
+
+    void
+    RoutingProtocol::AddWormTunnel(Ipv4Address firstEnd, Ipv4Address secondEnd,
+                                   Ipv4Address firstEndWifi, Ipv4Address secondEndWifi)
+    {
+      NS_LOG_FUNCTION(this << firstEnd << secondEnd << firstEndWifi << secondEndWifi);
+      WormTunnelConfig config = {firstEnd, secondEnd, firstEndWifi, secondEndWifi};
+      m_wormTunnelConfig.push_back(config);
+    }
+
+    void
+    RoutingProtocol::CompileWormTunnels()
+    {
+      NS_LOG_FUNCTION(this);
+      m_wormTunnels.clear();
+      if (!EnableWrmAttack)
+      {
+        return;
+      }
+      std::vector<WormTunnelConfig> configs = m_wormTunnelConfig;
+      WormTunnelConfig attributes = {FirstEndOfWormTunnel, SecondEndOfWormTunnel,
+                                     FirstEndWifiWormTunnel, SecondEndWifiWormTunnel};
+      configs.insert(configs.begin(), attributes);
+      for (std::vector<WormTunnelConfig>::const_iterator i = configs.begin(); i != configs.end(); ++i)
+      {
+        // Each tunnel is seen from both ends; keep the ends this node owns
+        WormTunnelEnd ends[2] = {{i->m_secondEnd, i->m_firstEnd, i->m_firstEndWifi, 0, Ipv4InterfaceAddress(), -1},
+                                 {i->m_firstEnd, i->m_secondEnd, i->m_secondEndWifi, 0, Ipv4InterfaceAddress(), -1}};
+        for (uint32_t k = 0; k < 2; ++k)
+        {
+          WormTunnelEnd &end = ends[k];
+          int32_t interface = m_ipv4->GetInterfaceForAddress(end.m_local);
+          if (interface < 0 || FindWormTunnelByPeer(end.m_peer) != 0)
+          {
+            continue;
+          }
+          end.m_device = m_ipv4->GetNetDevice(interface);
+          end.m_iface = m_ipv4->GetAddress(interface, 0);
+          end.m_deliveryInterface = m_ipv4->GetInterfaceForAddress(end.m_localWifi);
+          if (end.m_deliveryInterface < 0)
+          {
+            // The configured wifi address is not ours; report delivery on our wifi interface
+            for (uint32_t j = 0; j < m_ipv4->GetNInterfaces(); ++j)
+            {
+              if (m_ipv4->GetNetDevice(j)->GetObject<WifiNetDevice>() != 0)
+              {
+                end.m_deliveryInterface = j;
+                break;
+              }
+            }
+            NS_LOG_WARN("Wormhole tunnel end " << end.m_local << ": wifi address " << end.m_localWifi
+                                               << " is not on this node, delivering on interface "
+                                               << end.m_deliveryInterface);
+          }
+          NS_LOG_LOGIC("Wormhole tunnel " << end.m_local << " <-> " << end.m_peer << " on interface " << interface);
+          m_wormTunnels.push_back(end);
+        }
+      }
+    }
+
+    const RoutingProtocol::WormTunnelEnd *
+    RoutingProtocol::FindWormTunnelByPeer(Ipv4Address peer) const
+    {
+      for (std::vector<WormTunnelEnd>::const_iterator i = m_wormTunnels.begin(); i != m_wormTunnels.end(); ++i)
+      {
+        if (i->m_peer == peer)
+        {
+          return &(*i);
+        }
+      }
+      return 0;
+    }
+
+    const RoutingProtocol::WormTunnelEnd *
+    RoutingProtocol::FindWormTunnelByLocal(Ipv4Address local) const
+    {
+      for (std::vector<WormTunnelEnd>::const_iterator i = m_wormTunnels.begin(); i != m_wormTunnels.end(); ++i)
+      {
+        if (i->m_local == local)
+        {
+          return &(*i);
+        }
+      }
+      return 0;
+    }
+
+    void
+    RoutingProtocol::AddSocket(Ptr<Socket> socket, Ipv4InterfaceAddress iface, bool broadcast)
+    {
+      NS_LOG_FUNCTION(this << socket << iface << broadcast);
+      if (broadcast)
+      {
+        m_socketSubnetBroadcastAddresses.insert(std::make_pair(socket, iface));
+      }
+      else
+      {
+        m_socketAddresses.insert(std::make_pair(socket, iface));
+      }
+      SocketIndexEntry entry = {PeekPointer(socket), iface, broadcast};
+      m_socketIndex.push_back(entry);
+    }
+
+    void
+    RoutingProtocol::RemoveSocket(Ptr<Socket> socket)
+    {
+      NS_LOG_FUNCTION(this << socket);
+      for (std::vector<SocketIndexEntry>::iterator j = m_socketIndex.begin(); j != m_socketIndex.end(); ++j)
+      {
+        if (j->m_socket == PeekPointer(socket))
+        {
+          if (j->m_broadcast)
+          {
+            m_socketSubnetBroadcastAddresses.erase(socket);
+          }
+          else
+          {
+            m_socketAddresses.erase(socket);
+          }
+          m_socketIndex.erase(j);
+          return;
+        }
+      }
+    }
+
+    const RoutingProtocol::ReceiverEntry *
+    RoutingProtocol::ResolveReceiver(Ipv4Address receiver)
+    {
+      if (m_receiverCache.empty())
+      {
+        for (uint32_t i = 0; i < m_ipv4->GetNInterfaces(); ++i)
+        {
+          for (uint32_t j = 0; j < m_ipv4->GetNAddresses(i); ++j)
+          {
+            ReceiverEntry entry = {m_ipv4->GetAddress(i, j).GetLocal(), static_cast<int32_t>(i),
+                                   m_ipv4->GetNetDevice(i), m_ipv4->GetAddress(i, 0)};
+            m_receiverCache.push_back(entry);
+          }
+        }
+      }
+      for (std::vector<ReceiverEntry>::const_iterator j = m_receiverCache.begin(); j != m_receiverCache.end(); ++j)
+      {
+        if (j->m_address == receiver)
+        {
+          return &*j;
+        }
       }
+      NS_FATAL_ERROR("No interface for local address " << receiver);
+      return 0;
     }
 
     Ptr<Socket>
@@ -2281,6 +2924,7 @@ namespace ns3
     RoutingProtocol::DoInitialize(void)
     {
       NS_LOG_FUNCTION(this);
+      AttachTimerWheel();
       uint32_t startTime;
       if (m_enableHello)
       {
@@ -2289,6 +2933,10 @@ namespace ns3
         NS_LOG_DEBUG("Starting at time " << startTime << "ms");
         m_htimer.Schedule(MilliSeconds(startTime));
       }
+      m_rttTable.SetPendingTimeout(m_pathDiscoveryTime);
+      m_rttTable.SetSuspicionFactor(m_rttSuspicionFactor);
+      m_helloRtt.SetHoldTime(Time(m_allowedHelloLoss * m_helloInterval));
+      CompileWormTunnels();
       Ipv4RoutingProtocol::DoInitialize();
     }
 
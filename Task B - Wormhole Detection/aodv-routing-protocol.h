@@ -33,13 +33,19 @@
 #include "aodv-packet.h"
 #include "aodv-neighbor.h"
 #include "aodv-dpd.h"
+#include "aodv-rtt-table.h"
+#include "aodv-hello-rtt.h"
+#include "aodv-timer-wheel.h"
 #include "ns3/node.h"
 #include "ns3/random-variable-stream.h"
 #include "ns3/output-stream-wrapper.h"
 #include "ns3/ipv4-routing-protocol.h"
 #include "ns3/ipv4-interface.h"
 #include "ns3/ipv4-l3-protocol.h"
+#include "ns3/traced-callback.h"
+#include "ns3/event-id.h"
 #include <map>
+#include <queue>
 
 namespace ns3
 {
@@ -108,6 +114,19 @@ namespace ns3
        * \param len the maximum queue length
        */
       void SetMaxQueueLen(uint32_t len);
+      /**
+       * Get the slots of the RREQ id and duplicate packet caches
+       * \returns the slots of each cache
+       */
+      uint32_t GetIdCacheCapacity() const
+      {
+        return m_rreqIdCache.GetCapacity();
+      }
+      /**
+       * Set the slots of the RREQ id and duplicate packet caches
+       * \param capacity the slots of each cache
+       */
+      void SetIdCacheCapacity(uint32_t capacity);
       /**
        * Get destination only flag
        * \returns the destination only flag
@@ -195,6 +214,105 @@ namespace ns3
       Ipv4Address SecondEndOfWormTunnel;
       Ipv4Address FirstEndWifiWormTunnel;
       Ipv4Address SecondEndWifiWormTunnel;
+      /**
+       * Register an additional wormhole tunnel, on top of the one given by the
+       * *WormTunnel attributes. Must be called before the protocol is initialized;
+       * only tunnels ending on this node take effect.
+       * \param firstEnd tunnel address of the first end
+       * \param secondEnd tunnel address of the second end
+       * \param firstEndWifi wifi address of the first end
+       * \param secondEndWifi wifi address of the second end
+       */
+      void AddWormTunnel(Ipv4Address firstEnd, Ipv4Address secondEnd,
+                         Ipv4Address firstEndWifi, Ipv4Address secondEndWifi);
+
+      /**
+       * Get per-hop RTT state of a neighbor
+       * \param neighbor the neighbor address
+       * \param srtt [out] smoothed per-hop RTT
+       * \param rttvar [out] per-hop RTT mean deviation
+       * \returns true if at least one sample was taken for this neighbor
+       */
+      bool GetNeighborRtt(Ipv4Address neighbor, Time &srtt, Time &rttvar) const;
+      /**
+       * Get one-hop RTT state of a neighbor taken from Hello timestamp echoes
+       * \param neighbor the neighbor address
+       * \param estimate [out] RTT estimate
+       * \param variation [out] RTT mean deviation
+       * \returns true if at least one sample was taken for this neighbor
+       */
+      bool GetHelloRtt(Ipv4Address neighbor, Time &estimate, Time &variation) const;
+      /**
+       * Get per-hop route discovery RTT state of a destination
+       * \param dst the destination address
+       * \param estimate [out] per-hop RTT estimate
+       * \param variation [out] per-hop RTT mean deviation
+       * \returns true if at least one discovery of dst was timed
+       */
+      bool GetRouteDiscoveryRtt(Ipv4Address dst, Time &estimate, Time &variation) const;
+
+      /**
+       * TracedCallback signature for Hello RTT samples.
+       *
+       * \param [in] neighbor the neighbor the sample was taken for
+       * \param [in] sample the one-hop RTT sample
+       * \param [in] estimate the neighbor RTT estimate after the sample
+       */
+      typedef void (*HelloRttTracedCallback)(Ipv4Address neighbor, Time sample, Time estimate);
+
+      /**
+       * TracedCallback signature for route discovery RTT samples.
+       *
+       * \param [in] dst the destination the RREP came from
+       * \param [in] sample the discovery RTT divided by the hop count to the replier
+       * \param [in] estimate the destination per-hop RTT estimate after the sample
+       */
+      typedef void (*RouteDiscoveryRttTracedCallback)(Ipv4Address dst, Time sample, Time estimate);
+
+      /**
+       * TracedCallback signature for wormhole suspicion events.
+       *
+       * \param [in] neighbor the suspected neighbor
+       * \param [in] sample the per-hop RTT sample that triggered the check
+       * \param [in] srtt the neighbor smoothed per-hop RTT
+       */
+      typedef void (*WormholeSuspectTracedCallback)(Ipv4Address neighbor, Time sample, Time srtt);
+
+      /// Reason why a data packet was dropped by the routing layer
+      enum DropReason
+      {
+        DROP_BLACKHOLE = 0, ///< Malicious node swallowed the packet
+        DROP_NO_ROUTE,      ///< No valid route to forward the packet
+        DROP_DUPLICATE,     ///< Duplicated broadcast packet
+        DROP_TTL_EXPIRED,   ///< Broadcast TTL exhausted
+        DROP_QUARANTINE,    ///< Next hop is a quarantined neighbor
+        DROP_REASON_COUNT   ///< Number of drop reasons, not a reason
+      };
+
+      /**
+       * TracedCallback signature for data packet drops.
+       *
+       * \param [in] packet the dropped packet
+       * \param [in] header the IP header of the packet
+       * \param [in] reason the DropReason
+       */
+      typedef void (*DropTracedCallback)(Ptr<const Packet> packet, const Ipv4Header &header, DropReason reason);
+
+      /**
+       * Get the number of data packets dropped for a reason
+       * \param reason the drop reason
+       * \returns the number of packets dropped so far
+       */
+      uint64_t GetDropCount(DropReason reason) const
+      {
+        return m_drops.m_count[reason];
+      }
+      /**
+       * Print the drop counters of this node
+       * \param stream the output stream
+       * \param unit the time unit to use (default Time::S)
+       */
+      void PrintDropStatistics(Ptr<OutputStreamWrapper> stream, Time::Unit unit = Time::S) const;
 
       /**
        * Assign a fixed random variable stream number to the random variables
@@ -254,12 +372,37 @@ namespace ns3
       bool m_destinationOnly;  ///< Indicates only the destination may respond to this RREQ.
       bool m_gratuitousReply;  ///< Indicates whether a gratuitous RREP should be unicast to the node originated route discovery.
       bool m_enableHello;      ///< Indicates whether a hello messages enable
+      bool m_enableHelloRtt;   ///< Indicates whether hello messages carry a timestamp echo
       bool m_enableBroadcast;  ///< Indicates whether a a broadcast data packets forwarding enable
+      bool m_enableTimerWheel; ///< Indicates whether the periodic timers run on the shared timer wheel
+      Time m_timerWheelGranularity; ///< Tick length of the shared timer wheel
       //\}
 
       // TODO check
       // variable to enable/disable wormhole functionality. CNLAB
       bool EnableWrmAttack;
+      /// Wormhole tunnel as configured: first end, second end, first end wifi, second end wifi
+      struct WormTunnelConfig
+      {
+        Ipv4Address m_firstEnd;      ///< tunnel address of the first end
+        Ipv4Address m_secondEnd;     ///< tunnel address of the second end
+        Ipv4Address m_firstEndWifi;  ///< wifi address of the first end
+        Ipv4Address m_secondEndWifi; ///< wifi address of the second end
+      };
+      /// Tunnels registered with AddWormTunnel
+      std::vector<WormTunnelConfig> m_wormTunnelConfig;
+      /// A wormhole tunnel end owned by this node, resolved against its interfaces
+      struct WormTunnelEnd
+      {
+        Ipv4Address m_peer;              ///< tunnel address of the other end
+        Ipv4Address m_local;             ///< tunnel address of this end
+        Ipv4Address m_localWifi;         ///< wifi address of this end
+        Ptr<NetDevice> m_device;         ///< device of the tunnel interface
+        Ipv4InterfaceAddress m_iface;    ///< address of the tunnel interface
+        int32_t m_deliveryInterface;     ///< interface local delivery to the tunnel address is reported on, -1 for the incoming one
+      };
+      /// Tunnel ends of this node, empty unless EnableWrmAttack is set
+      std::vector<WormTunnelEnd> m_wormTunnels;
 
       /// IP protocol
       Ptr<Ipv4> m_ipv4;
@@ -267,23 +410,107 @@ namespace ns3
       std::map<Ptr<Socket>, Ipv4InterfaceAddress> m_socketAddresses;
       /// Raw subnet directed broadcast socket per each IP interface, map socket -> iface address (IP + mask)
       std::map<Ptr<Socket>, Ipv4InterfaceAddress> m_socketSubnetBroadcastAddresses;
+      /// Entry of the receive-side socket index
+      struct SocketIndexEntry
+      {
+        Socket *m_socket;             ///< socket identity, owned by one of the maps above
+        Ipv4InterfaceAddress m_iface; ///< interface address of the socket
+        bool m_broadcast;             ///< true for a subnet directed broadcast socket
+      };
+      /// Both socket maps as one flat array, so RecvAodv resolves a socket in a single scan of a few entries
+      std::vector<SocketIndexEntry> m_socketIndex;
+      /// Interface data of one local address, as the control handlers need it
+      struct ReceiverEntry
+      {
+        Ipv4Address m_address;        ///< local address
+        int32_t m_interface;          ///< interface index of the address
+        Ptr<NetDevice> m_device;      ///< device of the interface
+        Ipv4InterfaceAddress m_iface; ///< first interface address of the interface
+      };
+      /// All local addresses, built on first use and cleared by every interface or address change
+      std::vector<ReceiverEntry> m_receiverCache;
       /// Loopback device used to defer RREQ until packet will be fully formed
       Ptr<NetDevice> m_lo;
 
       /// Routing table
       RoutingTable m_routingTable;
+      /// Route of a recently used destination, as RouteOutput resolved it
+      struct RouteCacheEntry
+      {
+        Ipv4Address m_dst;            ///< destination
+        RoutingTableEntry *m_route;   ///< routing table entry of the destination, 0 if the slot is empty
+        Ipv4Address m_nextHop;        ///< next hop of m_route when it was cached
+        RoutingTableEntry *m_gateway; ///< routing table entry of the next hop, 0 if there was none
+        uint32_t m_generation;        ///< routing table generation the pointers were taken at
+        Time m_refreshed;             ///< last time the lifetimes were extended
+      };
+      /// Slots of the destination cache
+      static const uint32_t ROUTE_CACHE_SIZE = 4;
+      /// Last destinations RouteOutput found a valid route for
+      RouteCacheEntry m_routeCache[ROUTE_CACHE_SIZE];
+      /// Slot the next cached destination replaces
+      uint32_t m_routeCacheNext;
       /// A "drop-front" queue used by the routing layer to buffer packets to which it does not have a route.
       RequestQueue m_queue;
       /// Broadcast ID
       uint32_t m_requestId;
       /// Request sequence number
       uint32_t m_seqNo;
+      /// Serialized RREQ, type header included, that SendRequest patches instead of serializing headers per packet
+      struct RreqTemplate
+      {
+        bool m_valid;             ///< the bytes have been built
+        Ipv4Address m_dst;        ///< destination the bytes were built for
+        bool m_unknownSeqno;      ///< U flag the bytes were built with
+        bool m_gratuitousRrep;    ///< G flag the bytes were built with
+        bool m_destinationOnly;   ///< D flag the bytes were built with
+        uint8_t m_bytes[24];      ///< TypeHeader followed by RreqHeader
+      };
+      /// Last RREQ built; retries of a discovery only patch the mutable fields
+      RreqTemplate m_rreqTemplate;
       /// Handle duplicated RREQ
       IdCache m_rreqIdCache;
       /// Handle duplicated broadcast/multicast packets
       DuplicatePacketDetection m_dpd;
       /// Handle neighbors
       Neighbors m_nb;
+      /// Per-neighbor RTT estimates taken from RREQ/RREP exchanges
+      NeighborRttTable m_rttTable;
+      /// Deviations of a neighbor per-hop RTT from the node-wide estimate, in mean deviations, before it is suspected
+      uint32_t m_rttSuspicionFactor;
+      /// Fired when a neighbor per-hop RTT exceeds the suspicion bound
+      TracedCallback<Ipv4Address, Time, Time> m_wormholeSuspectTrace;
+      /// Per-neighbor one-hop RTT estimates taken from Hello timestamp echoes
+      HelloRttTable m_helloRtt;
+      /// Fired for every Hello RTT sample
+      TracedCallback<Ipv4Address, Time, Time> m_helloRttTrace;
+      /// Per-destination per-hop RTT estimates taken from timed RREQ/RREP exchanges
+      std::map<Ipv4Address, Ptr<RttMeanDeviation> > m_discoveryRtt;
+      /// Fired for every route discovery RTT sample
+      TracedCallback<Ipv4Address, Time, Time> m_discoveryRttTrace;
+      /// Indicates whether suspected wormhole neighbors are quarantined
+      bool m_enableQuarantine;
+      /// Quarantined neighbors and the absolute time their quarantine ends
+      std::map<Ipv4Address, Time> m_quarantine;
+      /// Quarantine expiry heap node: absolute time at which the neighbor must be checked
+      typedef std::pair<Time, Ipv4Address> QuarantineExpiry;
+      /// Min-heap of pending quarantine expiries; a refreshed quarantine leaves a stale node behind
+      std::priority_queue<QuarantineExpiry, std::vector<QuarantineExpiry>, std::greater<QuarantineExpiry>> m_quarantineExpiry;
+      /// Bits of the quarantine filter
+      static const uint32_t QUARANTINE_FILTER_BITS = 1024;
+      /// One-hash filter over m_quarantine, so a neighbor that is not quarantined costs one bit test
+      uint64_t m_quarantineFilter[QUARANTINE_FILTER_BITS / 64];
+      /// Per-node drop counters, on their own cache line so nodes never share one
+      struct alignas(64) DropCounters
+      {
+        uint64_t m_count[DROP_REASON_COUNT]; ///< Packets dropped, indexed by DropReason
+      };
+      /// Drop counters of this node
+      DropCounters m_drops;
+      /// Fired for each dropped data packet
+      TracedCallback<Ptr<const Packet>, const Ipv4Header &, DropReason> m_dropTrace;
+      /// Interval between drop reports, zero to report at the end of the run only
+      Time m_dropReportInterval;
       /// Number of RREQs used for RREQ rate control
       uint16_t m_rreqCount;
       /// Number of RERRs used for RERR rate control
@@ -315,6 +542,54 @@ namespace ns3
        * \returns true if forwarded
        */
       bool Forwarding(Ptr<const Packet> p, const Ipv4Header &header, UnicastForwardCallback ucb, ErrorCallback ecb);
+      /**
+       * Account for a dropped data packet
+       *
+       * \param p the dropped packet
+       * \param header the IP header
+       * \param reason the drop reason
+       */
+      void NotifyDrop(Ptr<const Packet> p, const Ipv4Header &header, DropReason reason)
+      {
+        ++m_drops.m_count[reason];
+        if (!m_dropTrace.IsEmpty())
+        {
+          m_dropTrace(p, header, reason);
+        }
+      }
+      /**
+       * Filter bit of a neighbor
+       * \param neighbor the neighbor address
+       * \returns the bit index in m_quarantineFilter
+       */
+      static uint32_t QuarantineBit(Ipv4Address neighbor)
+      {
+        return (neighbor.Get() * 2654435761u) >> 22;
+      }
+      /**
+       * Check whether a neighbor is quarantined
+       * \param neighbor the neighbor address
+       * \returns true if the neighbor is quarantined
+       */
+      bool IsQuarantined(Ipv4Address neighbor)
+      {
+        uint32_t bit = QuarantineBit(neighbor);
+        return ((m_quarantineFilter[bit >> 6] >> (bit & 63)) & 1) && LookupQuarantine(neighbor);
+      }
+      /**
+       * Exact quarantine check behind the filter; ends expired quarantines
+       * \param neighbor the neighbor address
+       * \returns true if the neighbor is quarantined
+       */
+      bool LookupQuarantine(Ipv4Address neighbor);
+      /// End the quarantines that expired, taken from the top of the expiry heap
+      void PurgeQuarantine();
+      /**
+       * Quarantine a neighbor for BlackListTimeout: routes through it are
+       * invalidated and its RREQs, RREPs and forwarded data are refused
+       * \param neighbor the neighbor address
+       */
+      void Quarantine(Ipv4Address neighbor);
       /**
        * Repeated attempts by a source node at route discovery for a single destination
        * use the expanding ring search technique.
@@ -328,6 +603,32 @@ namespace ns3
        * \return true if route to destination address addr exist
        */
       bool UpdateRouteLifeTime(Ipv4Address addr, Time lt);
+      /**
+       * Extend the lifetime of a VALID entry to at least lt and reset its RREQ count
+       * \param rt the entry, looked up in place
+       * \param lt proposed lifetime
+       */
+      void ExtendRouteLifeTime(RoutingTableEntry *rt, Time lt);
+      /**
+       * Find a destination in the route cache
+       * \param dst the destination
+       * \return the slot if its pointers are current and the route is still valid and unexpired, else 0
+       */
+      RouteCacheEntry *LookupRouteCache(Ipv4Address dst);
+      /**
+       * Cache the route of a destination
+       * \param dst the destination
+       * \param rt its VALID routing table entry
+       * \return the slot
+       */
+      RouteCacheEntry &AddRouteCache(Ipv4Address dst, RoutingTableEntry *rt);
+      /**
+       * Extend the lifetimes of a cached route and of its next hop, as
+       * UpdateRouteLifeTime does for both after a route lookup. Packets
+       * sent in the same instant extend them once.
+       * \param cached the slot
+       */
+      void RefreshRouteCache(RouteCacheEntry &cached);
       /**
        * Update neighbor record.
        * \param receiver is supposed to be my interface
@@ -340,6 +641,38 @@ namespace ns3
        * \returns true if the IP address is the node's IP address
        */
       bool IsMyOwnAddress(Ipv4Address src);
+      /// Resolve the configured wormhole tunnels into m_wormTunnels
+      void CompileWormTunnels();
+      /**
+       * Find the tunnel end of this node whose other end has the given address
+       * \param peer the tunnel address of the other end
+       * \returns the tunnel end, or 0 if none
+       */
+      const WormTunnelEnd *FindWormTunnelByPeer(Ipv4Address peer) const;
+      /**
+       * Find the tunnel end of this node with the given tunnel address
+       * \param local the tunnel address of this end
+       * \returns the tunnel end, or 0 if none
+       */
+      const WormTunnelEnd *FindWormTunnelByLocal(Ipv4Address local) const;
+      /**
+       * Register an AODV socket in the socket maps and the socket index
+       * \param socket the socket
+       * \param iface the interface address of the socket
+       * \param broadcast true for a subnet directed broadcast socket
+       */
+      void AddSocket(Ptr<Socket> socket, Ipv4InterfaceAddress iface, bool broadcast);
+      /**
+       * Remove an AODV socket from the socket maps and the socket index
+       * \param socket the socket
+       */
+      void RemoveSocket(Ptr<Socket> socket);
+      /**
+       * Resolve a local address to its interface, device and interface address
+       * \param receiver the local address
+       * \return the cache entry, valid until the next interface or address change
+       */
+      const ReceiverEntry *ResolveReceiver(Ipv4Address receiver);
       /**
        * Find unicast socket with local interface address iface
        *
@@ -418,6 +751,12 @@ namespace ns3
        * \param dst destination address
        */
       void SendRequest(Ipv4Address dst);
+      /**
+       * Serialize a RREQ into m_rreqTemplate unless it already holds one for
+       * the same destination and flags
+       * \param rreqHeader the RREQ
+       */
+      void PrepareRreqTemplate(RreqHeader const &rreqHeader);
       /** Send RREP
        * \param rreqHeader route request header
        * \param toOrigin routing table entry to originator
@@ -458,19 +797,48 @@ namespace ns3
        * \param destination - destination node IP address
        */
       void SendTo(Ptr<Socket> socket, Ptr<Packet> packet, Ipv4Address destination);
+      /**
+       * Send packet to destination socket after a jitter. Jittered control
+       * packets of the node share one simulator event.
+       * \param jitter - delay before the packet is sent
+       * \param socket - destination node socket
+       * \param packet - packet to send
+       * \param destination - destination node IP address
+       */
+      void ScheduleSendTo(Time jitter, Ptr<Socket> socket, Ptr<Packet> packet, Ipv4Address destination);
+      /// Send the jittered control packets that are due and schedule the next one
+      void SendPendingTx();
+
+      /// A jittered control packet waiting to be sent
+      struct PendingTx
+      {
+        Ptr<Socket> m_socket;       ///< socket to send through
+        Ptr<Packet> m_packet;       ///< packet to send
+        Ipv4Address m_destination;  ///< destination address
+      };
+      /// Jittered control packets by send time; packets due at the same time keep their order
+      std::multimap<Time, PendingTx> m_pendingTx;
+      /// Event for the earliest pending control packet
+      EventId m_pendingTxEvent;
 
+      /// Move the periodic timers to the shared timer wheel if it is enabled
+      void AttachTimerWheel();
       /// Hello timer
-      Timer m_htimer;
+      WheelTimer m_htimer;
       /// Schedule next send of hello message
       void HelloTimerExpire();
       /// RREQ rate limit timer
-      Timer m_rreqRateLimitTimer;
+      WheelTimer m_rreqRateLimitTimer;
       /// Reset RREQ count and schedule RREQ rate limit timer with delay 1 sec.
       void RreqRateLimitTimerExpire();
       /// RERR rate limit timer
-      Timer m_rerrRateLimitTimer;
+      WheelTimer m_rerrRateLimitTimer;
       /// Reset RERR count and schedule RERR rate limit timer with delay 1 sec.
       void RerrRateLimitTimerExpire();
+      /// Drop report timer
+      Timer m_dropReportTimer;
+      /// Print the drop counters and schedule the next report
+      void DropReportTimerExpire();
       /// Map IP address + RREQ timer.
       std::map<Ipv4Address, Timer> m_addressReqTimer;
       /**
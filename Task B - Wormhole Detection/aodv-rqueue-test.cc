@@ -0,0 +1,183 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/test.h"
+#include "ns3/aodv-rqueue.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/socket.h"
+
+using namespace ns3;
+using namespace aodv;
+
+/**
+ * \ingroup aodv-test
+ * \ingroup tests
+ *
+ * \brief Request queue Test
+ *
+ * Each destination must drain in arrival order without touching the
+ * packets of other destinations, duplicates must be refused, a full
+ * queue must drop its oldest packet and expired packets must be dropped
+ * through the error callback.
+ */
+class AodvRequestQueueTestCase : public TestCase
+{
+public:
+  AodvRequestQueueTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \brief Count a dropped packet
+   * \param p the packet
+   * \param header the IPv4 header
+   * \param err the socket error
+   */
+  void Error (Ptr<const Packet> p, const Ipv4Header &header, Socket::SocketErrno err);
+  /**
+   * \brief Make a queue entry
+   * \param p the packet
+   * \param dst the destination
+   * \returns the entry
+   */
+  QueueEntry MakeEntry (Ptr<const Packet> p, Ipv4Address dst);
+  /// Queue a packet for B after the first ones
+  void MakeLate (void);
+  /// Check the queue once the first packets expired
+  void CheckExpired (void);
+
+  RequestQueue m_queue;  //!< Queue under test
+  uint32_t m_dropped;    //!< Packets dropped through the error callback
+};
+
+AodvRequestQueueTestCase::AodvRequestQueueTestCase ()
+  : TestCase ("Request queue"),
+    m_queue (4, Seconds (2)),
+    m_dropped (0)
+{
+}
+
+void
+AodvRequestQueueTestCase::Error (Ptr<const Packet> p, const Ipv4Header &header, Socket::SocketErrno err)
+{
+  ++m_dropped;
+}
+
+QueueEntry
+AodvRequestQueueTestCase::MakeEntry (Ptr<const Packet> p, Ipv4Address dst)
+{
+  Ipv4Header header;
+  header.SetDestination (dst);
+  return QueueEntry (p, header, QueueEntry::UnicastForwardCallback (),
+                     MakeCallback (&AodvRequestQueueTestCase::Error, this));
+}
+
+void
+AodvRequestQueueTestCase::MakeLate (void)
+{
+  QueueEntry late = MakeEntry (Create<Packet> (10), Ipv4Address ("10.0.0.2"));
+  NS_TEST_ASSERT_MSG_EQ (m_queue.Enqueue (late), true, "late packet queued");
+}
+
+void
+AodvRequestQueueTestCase::CheckExpired (void)
+{
+  // The two packets queued at 0 s expired at 2 s, the one queued at 1 s stays
+  NS_TEST_ASSERT_MSG_EQ (m_queue.GetSize (), 1, "expired packets purged");
+  NS_TEST_ASSERT_MSG_EQ (m_dropped, 2, "expired packets dropped");
+  NS_TEST_ASSERT_MSG_EQ (m_queue.Find (Ipv4Address ("10.0.0.2")), true, "late packet kept");
+}
+
+void
+AodvRequestQueueTestCase::DoRun (void)
+{
+  Ipv4Address a ("10.0.0.1");
+  Ipv4Address b ("10.0.0.2");
+  Ptr<Packet> p[5];
+  for (uint32_t i = 0; i < 5; ++i)
+    {
+      p[i] = Create<Packet> (10);
+    }
+
+  QueueEntry e0 = MakeEntry (p[0], a);
+  QueueEntry e1 = MakeEntry (p[1], b);
+  QueueEntry e2 = MakeEntry (p[2], a);
+  QueueEntry dup = MakeEntry (p[0], a);
+  NS_TEST_ASSERT_MSG_EQ (m_queue.Enqueue (e0), true, "first packet queued");
+  NS_TEST_ASSERT_MSG_EQ (m_queue.Enqueue (e1), true, "second packet queued");
+  NS_TEST_ASSERT_MSG_EQ (m_queue.Enqueue (e2), true, "third packet queued");
+  NS_TEST_ASSERT_MSG_EQ (m_queue.Enqueue (dup), false, "duplicate refused");
+  NS_TEST_ASSERT_MSG_EQ (m_queue.GetSize (), 3, "three packets queued");
+
+  // Destination A drains in arrival order and leaves B alone
+  QueueEntry out;
+  NS_TEST_ASSERT_MSG_EQ (m_queue.Dequeue (a, out), true, "A has packets");
+  NS_TEST_ASSERT_MSG_EQ (out.GetPacket ()->GetUid (), p[0]->GetUid (), "oldest A packet first");
+  NS_TEST_ASSERT_MSG_EQ (m_queue.Dequeue (a, out), true, "A has a second packet");
+  NS_TEST_ASSERT_MSG_EQ (out.GetPacket ()->GetUid (), p[2]->GetUid (), "newest A packet last");
+  NS_TEST_ASSERT_MSG_EQ (m_queue.Dequeue (a, out), false, "A drained");
+  NS_TEST_ASSERT_MSG_EQ (m_queue.Find (a), false, "A gone");
+  NS_TEST_ASSERT_MSG_EQ (m_queue.Find (b), true, "B kept");
+
+  // A full queue drops the oldest packet, B's, to make room
+  for (uint32_t i = 0; i < 4; ++i)
+    {
+      QueueEntry e = MakeEntry (p[i == 1 ? 4 : i], a);
+      NS_TEST_ASSERT_MSG_EQ (m_queue.Enqueue (e), true, "packet " << i << " queued");
+    }
+  NS_TEST_ASSERT_MSG_EQ (m_queue.GetSize (), 4, "queue full");
+  NS_TEST_ASSERT_MSG_EQ (m_dropped, 1, "oldest packet dropped");
+  NS_TEST_ASSERT_MSG_EQ (m_queue.Find (b), false, "B evicted");
+
+  m_queue.DropPacketWithDst (a);
+  NS_TEST_ASSERT_MSG_EQ (m_queue.GetSize (), 0, "A dropped");
+  NS_TEST_ASSERT_MSG_EQ (m_dropped, 5, "all A packets dropped");
+
+  // Expiry
+  m_dropped = 0;
+  QueueEntry x0 = MakeEntry (p[0], a);
+  QueueEntry x1 = MakeEntry (p[1], a);
+  NS_TEST_ASSERT_MSG_EQ (m_queue.Enqueue (x0), true, "x0 queued");
+  NS_TEST_ASSERT_MSG_EQ (m_queue.Enqueue (x1), true, "x1 queued");
+  Simulator::Schedule (Seconds (1), &AodvRequestQueueTestCase::MakeLate, this);
+  Simulator::Schedule (Seconds (2.5), &AodvRequestQueueTestCase::CheckExpired, this);
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup aodv-test
+ * \ingroup tests
+ *
+ * \brief AODV request queue TestSuite
+ */
+class AodvRequestQueueTestSuite : public TestSuite
+{
+public:
+  AodvRequestQueueTestSuite ()
+    : TestSuite ("aodv-request-queue", UNIT)
+  {
+    AddTestCase (new AodvRequestQueueTestCase, TestCase::QUICK);
+  }
+
+};
+
+static AodvRequestQueueTestSuite g_aodvRequestQueueTestSuite; //!< Static variable for test initialization
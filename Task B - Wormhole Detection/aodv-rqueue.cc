@@ -0,0 +1,272 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2009 IITP RAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Based on
+ *      NS-2 AODV model developed by the CMU/MONARCH group and optimized and
+ *      tuned by Samir Das and Mahesh Marina, University of Cincinnati;
+ *
+ *      AODV-UU implementation by Erik Nordström of Uppsala University
+ *      http://core.it.uu.se/core/index.php/AODV-UU
+ *
+ * Authors: Elena Buchatskaia <borovkovaes@iitp.ru>
+ *          Pavel Boyko <boyko@iitp.ru>
+ */
+#include "aodv-rqueue.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/socket.h"
+#include "ns3/log.h"
+
+namespace ns3
+{
+
+  NS_LOG_COMPONENT_DEFINE("AodvRequestQueue");
+
+  namespace aodv
+  {
+    RequestQueue::RequestQueue(uint32_t maxLen, Time routeToQueueTimeout)
+        : m_head(NONE),
+          m_tail(NONE),
+          m_size(0),
+          m_expireOrdered(true),
+          m_maxLen(maxLen),
+          m_queueTimeout(routeToQueueTimeout)
+    {
+    }
+
+    uint32_t
+    RequestQueue::GetSize()
+    {
+      Purge();
+      return m_size;
+    }
+
+    void
+    RequestQueue::SetQueueTimeout(Time t)
+    {
+      // A shorter timeout lets new entries expire before older ones
+      if (t < m_queueTimeout && m_size > 0)
+      {
+        m_expireOrdered = false;
+      }
+      m_queueTimeout = t;
+    }
+
+    bool
+    RequestQueue::Enqueue(QueueEntry &entry)
+    {
+      Purge();
+      Ipv4Address dst = entry.GetIpv4Header().GetDestination();
+      std::map<Ipv4Address, Bucket>::const_iterator b = m_buckets.find(dst);
+      if (b != m_buckets.end())
+      {
+        for (uint32_t i = b->second.m_head; i != NONE; i = m_slots[i].m_dstNext)
+        {
+          if (m_slots[i].m_entry.GetPacket()->GetUid() == entry.GetPacket()->GetUid())
+          {
+            return false;
+          }
+        }
+      }
+      entry.SetExpireTime(m_queueTimeout);
+      while (m_size > 0 && m_size >= m_maxLen)
+      {
+        Drop(m_slots[m_head].m_entry, "Drop the most aged packet"); // Drop the most aged packet
+        Unlink(m_head);
+      }
+      Link(entry);
+      return true;
+    }
+
+    void
+    RequestQueue::DropPacketWithDst(Ipv4Address dst)
+    {
+      NS_LOG_FUNCTION(this << dst);
+      Purge();
+      std::map<Ipv4Address, Bucket>::iterator b = m_buckets.find(dst);
+      if (b == m_buckets.end())
+      {
+        return;
+      }
+      uint32_t i = b->second.m_head;
+      while (i != NONE)
+      {
+        uint32_t next = m_slots[i].m_dstNext;
+        Drop(m_slots[i].m_entry, "DropPacketWithDst ");
+        Unlink(i);
+        i = next;
+      }
+    }
+
+    bool
+    RequestQueue::Dequeue(Ipv4Address dst, QueueEntry &entry)
+    {
+      Purge();
+      std::map<Ipv4Address, Bucket>::const_iterator b = m_buckets.find(dst);
+      if (b == m_buckets.end())
+      {
+        return false;
+      }
+      uint32_t head = b->second.m_head;
+      entry = m_slots[head].m_entry;
+      Unlink(head);
+      return true;
+    }
+
+    bool
+    RequestQueue::Find(Ipv4Address dst)
+    {
+      return m_buckets.find(dst) != m_buckets.end();
+    }
+
+    void
+    RequestQueue::Link(QueueEntry const &entry)
+    {
+      uint32_t slot;
+      if (m_free.empty())
+      {
+        slot = m_slots.size();
+        m_slots.push_back(Slot());
+      }
+      else
+      {
+        slot = m_free.back();
+        m_free.pop_back();
+      }
+      Slot &s = m_slots[slot];
+      s.m_entry = entry;
+      s.m_prev = m_tail;
+      s.m_next = NONE;
+      if (m_tail != NONE)
+      {
+        m_slots[m_tail].m_next = slot;
+      }
+      else
+      {
+        m_head = slot;
+      }
+      m_tail = slot;
+
+      Ipv4Address dst = entry.GetIpv4Header().GetDestination();
+      std::map<Ipv4Address, Bucket>::iterator b = m_buckets.find(dst);
+      s.m_dstNext = NONE;
+      if (b == m_buckets.end())
+      {
+        Bucket bucket = {slot, slot};
+        m_buckets.insert(std::make_pair(dst, bucket));
+        s.m_dstPrev = NONE;
+      }
+      else
+      {
+        s.m_dstPrev = b->second.m_tail;
+        m_slots[b->second.m_tail].m_dstNext = slot;
+        b->second.m_tail = slot;
+      }
+      ++m_size;
+    }
+
+    void
+    RequestQueue::Unlink(uint32_t slot)
+    {
+      Slot &s = m_slots[slot];
+      if (s.m_prev != NONE)
+      {
+        m_slots[s.m_prev].m_next = s.m_next;
+      }
+      else
+      {
+        m_head = s.m_next;
+      }
+      if (s.m_next != NONE)
+      {
+        m_slots[s.m_next].m_prev = s.m_prev;
+      }
+      else
+      {
+        m_tail = s.m_prev;
+      }
+
+      if (s.m_dstPrev == NONE && s.m_dstNext == NONE)
+      {
+        m_buckets.erase(s.m_entry.GetIpv4Header().GetDestination());
+      }
+      else
+      {
+        std::map<Ipv4Address, Bucket>::iterator b = m_buckets.find(s.m_entry.GetIpv4Header().GetDestination());
+        if (s.m_dstPrev != NONE)
+        {
+          m_slots[s.m_dstPrev].m_dstNext = s.m_dstNext;
+        }
+        else
+        {
+          b->second.m_head = s.m_dstNext;
+        }
+        if (s.m_dstNext != NONE)
+        {
+          m_slots[s.m_dstNext].m_dstPrev = s.m_dstPrev;
+        }
+        else
+        {
+          b->second.m_tail = s.m_dstPrev;
+        }
+      }
+
+      // Release the packet and the callbacks now, not when the slot is reused
+      s.m_entry = QueueEntry();
+      m_free.push_back(slot);
+      if (--m_size == 0)
+      {
+        m_expireOrdered = true;
+      }
+    }
+
+    void
+    RequestQueue::Purge()
+    {
+      if (m_expireOrdered)
+      {
+        // Entries expire in the order they were queued
+        while (m_head != NONE && m_slots[m_head].m_entry.GetExpireTime() < Seconds(0))
+        {
+          Drop(m_slots[m_head].m_entry, "Drop outdated packet ");
+          Unlink(m_head);
+        }
+        return;
+      }
+      uint32_t i = m_head;
+      while (i != NONE)
+      {
+        uint32_t next = m_slots[i].m_next;
+        if (m_slots[i].m_entry.GetExpireTime() < Seconds(0))
+        {
+          Drop(m_slots[i].m_entry, "Drop outdated packet ");
+          Unlink(i);
+        }
+        i = next;
+      }
+    }
+
+    void
+    RequestQueue::Drop(QueueEntry en, std::string reason)
+    {
+      NS_LOG_LOGIC(reason << en.GetPacket()->GetUid() << " " << en.GetIpv4Header().GetDestination());
+      en.GetErrorCallback()(en.GetPacket(), en.GetIpv4Header(),
+                            Socket::ERROR_NOROUTETOHOST);
+      return;
+    }
+
+  } // namespace aodv
+} // namespace ns3
@@ -0,0 +1,231 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/test.h"
+#include "ns3/aodv-rtable.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
+
+using namespace ns3;
+using namespace aodv;
+
+/**
+ * \ingroup aodv-test
+ * \ingroup tests
+ *
+ * \brief Routing table expiry Test
+ *
+ * Valid routes must turn invalid once their lifetime passes, invalid
+ * routes must go once their deletion time passes, an extended lifetime
+ * must postpone both and a route in search must never be purged.
+ */
+class AodvRoutingTableExpiryTestCase : public TestCase
+{
+public:
+  AodvRoutingTableExpiryTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /// Extend the lifetime of route A
+  void Extend (void);
+  /**
+   * \brief Check the state of a route
+   * \param dst the destination
+   * \param present whether the route must be in the table
+   * \param flag the expected flag if present
+   */
+  void CheckRoute (Ipv4Address dst, bool present, RouteFlags flag);
+
+  RoutingTable m_table; //!< Table under test
+};
+
+AodvRoutingTableExpiryTestCase::AodvRoutingTableExpiryTestCase ()
+  : TestCase ("Routing table expiry"),
+    m_table (Seconds (2))
+{
+}
+
+void
+AodvRoutingTableExpiryTestCase::Extend (void)
+{
+  RoutingTableEntry rt;
+  NS_TEST_ASSERT_MSG_EQ (m_table.LookupRoute (Ipv4Address ("10.0.0.1"), rt), true, "route A exists");
+  rt.SetLifeTime (Seconds (2));
+  NS_TEST_ASSERT_MSG_EQ (m_table.Update (rt), true, "route A updated");
+}
+
+void
+AodvRoutingTableExpiryTestCase::CheckRoute (Ipv4Address dst, bool present, RouteFlags flag)
+{
+  RoutingTableEntry rt;
+  bool found = m_table.LookupRoute (dst, rt);
+  NS_TEST_ASSERT_MSG_EQ (found, present, "presence of " << dst << " at " << Simulator::Now ().As (Time::S));
+  if (found && present)
+    {
+      NS_TEST_ASSERT_MSG_EQ (rt.GetFlag (), flag, "flag of " << dst << " at " << Simulator::Now ().As (Time::S));
+    }
+}
+
+void
+AodvRoutingTableExpiryTestCase::DoRun (void)
+{
+  Ipv4Address a ("10.0.0.1");
+  Ipv4Address b ("10.0.0.2");
+  Ipv4Address c ("10.0.0.3");
+  RoutingTableEntry ra (0, a, true, 1, Ipv4InterfaceAddress (), 1, a, Seconds (1));
+  RoutingTableEntry rb (0, b, true, 1, Ipv4InterfaceAddress (), 2, a, Seconds (3));
+  RoutingTableEntry rc (0, c, false, 0, Ipv4InterfaceAddress (), 0, Ipv4Address (), Seconds (1));
+  rc.SetFlag (IN_SEARCH);
+  NS_TEST_ASSERT_MSG_EQ (m_table.AddRoute (ra), true, "route A added");
+  NS_TEST_ASSERT_MSG_EQ (m_table.AddRoute (rb), true, "route B added");
+  NS_TEST_ASSERT_MSG_EQ (m_table.AddRoute (rc), true, "route C added");
+  NS_TEST_ASSERT_MSG_EQ (m_table.AddRoute (ra), false, "route A added twice");
+
+  // A now expires at 2.5 s instead of 1 s
+  Simulator::Schedule (Seconds (0.5), &AodvRoutingTableExpiryTestCase::Extend, this);
+  Simulator::Schedule (Seconds (2), &AodvRoutingTableExpiryTestCase::CheckRoute, this, a, true, VALID);
+  Simulator::Schedule (Seconds (2), &AodvRoutingTableExpiryTestCase::CheckRoute, this, b, true, VALID);
+  // A and B invalidated, deleted 2 s later
+  Simulator::Schedule (Seconds (3.5), &AodvRoutingTableExpiryTestCase::CheckRoute, this, a, true, INVALID);
+  Simulator::Schedule (Seconds (3.5), &AodvRoutingTableExpiryTestCase::CheckRoute, this, b, true, INVALID);
+  Simulator::Schedule (Seconds (3.5), &AodvRoutingTableExpiryTestCase::CheckRoute, this, c, true, IN_SEARCH);
+  Simulator::Schedule (Seconds (6), &AodvRoutingTableExpiryTestCase::CheckRoute, this, a, false, VALID);
+  Simulator::Schedule (Seconds (6), &AodvRoutingTableExpiryTestCase::CheckRoute, this, b, false, VALID);
+  Simulator::Schedule (Seconds (6), &AodvRoutingTableExpiryTestCase::CheckRoute, this, c, true, IN_SEARCH);
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup aodv-test
+ * \ingroup tests
+ *
+ * \brief Routing table touch Test
+ *
+ * A route touched in place must outlive its lifetime without an Update,
+ * a later SetLifeTime must override the touch, and the next hop entry
+ * handle must follow insertions and deletions.
+ */
+class AodvRoutingTableTouchTestCase : public TestCase
+{
+public:
+  AodvRoutingTableTouchTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /// Touch route A in place
+  void Touch (void);
+  /// Set the lifetime of route B after touching it
+  void Override (void);
+  /**
+   * \brief Check the flag of a route
+   * \param dst the destination
+   * \param flag the expected flag
+   */
+  void CheckFlag (Ipv4Address dst, RouteFlags flag);
+
+  RoutingTable m_table; //!< Table under test
+};
+
+AodvRoutingTableTouchTestCase::AodvRoutingTableTouchTestCase ()
+  : TestCase ("Routing table touch"),
+    m_table (Seconds (2))
+{
+}
+
+void
+AodvRoutingTableTouchTestCase::Touch (void)
+{
+  RoutingTableEntry *rt = m_table.LookupRoute (Ipv4Address ("10.0.0.1"));
+  NS_TEST_ASSERT_MSG_NE (rt, 0, "route A exists");
+  rt->Touch (Seconds (2));
+  NS_TEST_ASSERT_MSG_EQ (rt->GetLifeTime (), Seconds (2), "touch extends the lifetime");
+}
+
+void
+AodvRoutingTableTouchTestCase::Override (void)
+{
+  RoutingTableEntry *rt = m_table.LookupRoute (Ipv4Address ("10.0.0.2"));
+  NS_TEST_ASSERT_MSG_NE (rt, 0, "route B exists");
+  rt->Touch (Seconds (5));
+  rt->SetLifeTime (Seconds (1));
+  m_table.Commit (rt);
+  NS_TEST_ASSERT_MSG_EQ (rt->GetLifeTime (), Seconds (1), "SetLifeTime overrides a touch");
+}
+
+void
+AodvRoutingTableTouchTestCase::CheckFlag (Ipv4Address dst, RouteFlags flag)
+{
+  RoutingTableEntry rt;
+  NS_TEST_ASSERT_MSG_EQ (m_table.LookupRoute (dst, rt), true, "presence of " << dst);
+  NS_TEST_ASSERT_MSG_EQ (rt.GetFlag (), flag, "flag of " << dst << " at " << Simulator::Now ().As (Time::S));
+}
+
+void
+AodvRoutingTableTouchTestCase::DoRun (void)
+{
+  Ipv4Address a ("10.0.0.1");
+  Ipv4Address b ("10.0.0.2");
+  RoutingTableEntry ra (0, a, true, 1, Ipv4InterfaceAddress (), 1, a, Seconds (1));
+  RoutingTableEntry rb (0, b, true, 1, Ipv4InterfaceAddress (), 2, a, Seconds (10));
+  NS_TEST_ASSERT_MSG_EQ (m_table.AddRoute (ra), true, "route A added");
+
+  // B goes through A; the handle finds A, then loses it when A goes
+  NS_TEST_ASSERT_MSG_EQ (m_table.AddRoute (rb), true, "route B added");
+  RoutingTableEntry *toB = m_table.LookupRoute (b);
+  NS_TEST_ASSERT_MSG_EQ (m_table.LookupNextHopRoute (toB), m_table.LookupRoute (a), "next hop of B is A");
+  RoutingTableEntry rc (0, Ipv4Address ("10.0.0.3"), true, 1, Ipv4InterfaceAddress (), 1, Ipv4Address ("10.0.0.3"), Seconds (1));
+  NS_TEST_ASSERT_MSG_EQ (m_table.AddRoute (rc), true, "route C added");
+  NS_TEST_ASSERT_MSG_EQ (m_table.LookupNextHopRoute (toB), m_table.LookupRoute (a), "next hop of B is still A");
+  NS_TEST_ASSERT_MSG_EQ (m_table.DeleteRoute (a), true, "route A deleted");
+  NS_TEST_ASSERT_MSG_EQ (m_table.LookupNextHopRoute (toB), 0, "next hop of B is gone");
+  NS_TEST_ASSERT_MSG_EQ (m_table.AddRoute (ra), true, "route A added again");
+  NS_TEST_ASSERT_MSG_EQ (m_table.LookupNextHopRoute (toB), m_table.LookupRoute (a), "next hop of B is A again");
+
+  // A expires at 1 s unless touched; touched at 0.5 s it expires at 2.5 s
+  Simulator::Schedule (Seconds (0.5), &AodvRoutingTableTouchTestCase::Touch, this);
+  Simulator::Schedule (Seconds (2), &AodvRoutingTableTouchTestCase::CheckFlag, this, a, VALID);
+  Simulator::Schedule (Seconds (3), &AodvRoutingTableTouchTestCase::CheckFlag, this, a, INVALID);
+  // B set to expire at 1.5 s despite a touch to 5.5 s
+  Simulator::Schedule (Seconds (0.5), &AodvRoutingTableTouchTestCase::Override, this);
+  Simulator::Schedule (Seconds (2), &AodvRoutingTableTouchTestCase::CheckFlag, this, b, INVALID);
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup aodv-test
+ * \ingroup tests
+ *
+ * \brief AODV routing table TestSuite
+ */
+class AodvRoutingTableTestSuite : public TestSuite
+{
+public:
+  AodvRoutingTableTestSuite ()
+    : TestSuite ("aodv-routing-table", UNIT)
+  {
+    AddTestCase (new AodvRoutingTableExpiryTestCase, TestCase::QUICK);
+    AddTestCase (new AodvRoutingTableTouchTestCase, TestCase::QUICK);
+  }
+
+};
+
+static AodvRoutingTableTestSuite g_aodvRoutingTableTestSuite; //!< Static variable for test initialization
@@ -0,0 +1,607 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2009 IITP RAS
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Based on
+ *      NS-2 AODV model developed by the CMU/MONARCH group and optimized and
+ *      tuned by Samir Das and Mahesh Marina, University of Cincinnati;
+ *
+ *      AODV-UU implementation by Erik Nordström of Uppsala University
+ *      http://core.it.uu.se/core/index.php/AODV-UU
+ *
+ * Authors: Elena Buchatskaia <borovkovaes@iitp.ru>
+ *          Pavel Boyko <boyko@iitp.ru>
+ */
+
+#include "aodv-rtable.h"
+#include <algorithm>
+#include <iomanip>
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+
+namespace ns3
+{
+
+  NS_LOG_COMPONENT_DEFINE("AodvRoutingTable");
+
+  namespace aodv
+  {
+
+    /*
+     The Routing Table
+     */
+
+    RoutingTableEntry::RoutingTableEntry(Ptr<NetDevice> dev, Ipv4Address dst, bool vSeqNo, uint32_t seqNo,
+                                         Ipv4InterfaceAddress iface, uint16_t hops, Ipv4Address nextHop, Time lifetime)
+        : m_ackTimer(Timer::CANCEL_ON_DESTROY),
+          m_validSeqNo(vSeqNo),
+          m_seqNo(seqNo),
+          m_hops(hops),
+          m_lifeTime(lifetime + Simulator::Now()),
+          m_activeUntil(Time::Min()),
+          m_iface(iface),
+          m_flag(VALID),
+          m_reqCount(0),
+          m_blackListState(false),
+          m_blackListTimeout(Simulator::Now()),
+          m_expiryKey(Time::Max()),
+          m_nextHopEntry(0),
+          m_nextHopGeneration(0)
+    {
+      m_ipv4Route = Create<Ipv4Route>();
+      m_ipv4Route->SetDestination(dst);
+      m_ipv4Route->SetGateway(nextHop);
+      m_ipv4Route->SetSource(m_iface.GetLocal());
+      m_ipv4Route->SetOutputDevice(dev);
+    }
+
+    RoutingTableEntry::~RoutingTableEntry()
+    {
+    }
+
+    bool
+    RoutingTableEntry::InsertPrecursor(Ipv4Address id)
+    {
+      NS_LOG_FUNCTION(this << id);
+      if (!LookupPrecursor(id))
+      {
+        m_precursorList.push_back(id);
+        return true;
+      }
+      else
+      {
+        return false;
+      }
+    }
+
+    bool
+    RoutingTableEntry::LookupPrecursor(Ipv4Address id)
+    {
+      NS_LOG_FUNCTION(this << id);
+      for (std::vector<Ipv4Address>::const_iterator i = m_precursorList.begin(); i != m_precursorList.end(); ++i)
+      {
+        if (*i == id)
+        {
+          NS_LOG_LOGIC("Precursor " << id << " found");
+          return true;
+        }
+      }
+      NS_LOG_LOGIC("Precursor " << id << " not found");
+      return false;
+    }
+
+    bool
+    RoutingTableEntry::DeletePrecursor(Ipv4Address id)
+    {
+      NS_LOG_FUNCTION(this << id);
+      std::vector<Ipv4Address>::iterator i = std::remove(m_precursorList.begin(),
+                                                         m_precursorList.end(), id);
+      if (i == m_precursorList.end())
+      {
+        NS_LOG_LOGIC("Precursor " << id << " not found");
+        return false;
+      }
+      else
+      {
+        NS_LOG_LOGIC("Precursor " << id << " found");
+        m_precursorList.erase(i, m_precursorList.end());
+      }
+      return true;
+    }
+
+    void
+    RoutingTableEntry::DeleteAllPrecursors()
+    {
+      NS_LOG_FUNCTION(this);
+      m_precursorList.clear();
+    }
+
+    bool
+    RoutingTableEntry::IsPrecursorListEmpty() const
+    {
+      return m_precursorList.empty();
+    }
+
+    void
+    RoutingTableEntry::GetPrecursors(std::vector<Ipv4Address> &prec) const
+    {
+      NS_LOG_FUNCTION(this);
+      if (IsPrecursorListEmpty())
+      {
+        return;
+      }
+      for (std::vector<Ipv4Address>::const_iterator i = m_precursorList.begin(); i != m_precursorList.end(); ++i)
+      {
+        bool result = true;
+        for (std::vector<Ipv4Address>::const_iterator j = prec.begin(); j != prec.end(); ++j)
+        {
+          if (*j == *i)
+          {
+            result = false;
+          }
+        }
+        if (result)
+        {
+          prec.push_back(*i);
+        }
+      }
+    }
+
+    void
+    RoutingTableEntry::Invalidate(Time badLinkLifetime)
+    {
+      NS_LOG_FUNCTION(this << badLinkLifetime.As(Time::S));
+      if (m_flag == INVALID)
+      {
+        return;
+      }
+      m_flag = INVALID;
+      m_reqCount = 0;
+      m_lifeTime = badLinkLifetime + Simulator::Now();
+      m_activeUntil = Time::Min();
+    }
+
+    void
+    RoutingTableEntry::Print(Ptr<OutputStreamWrapper> stream, Time::Unit unit /* = Time::S */) const
+    {
+      std::ostream *os = stream->GetStream();
+      // Copy the current ostream state
+      std::ios oldState(nullptr);
+      oldState.copyfmt(*os);
+
+      *os << std::resetiosflags(std::ios::adjustfield) << std::setiosflags(std::ios::left);
+
+      std::ostringstream dest, gw, iface, expire;
+      dest << m_ipv4Route->GetDestination();
+      gw << m_ipv4Route->GetGateway();
+      iface << m_iface.GetLocal();
+      expire << std::setprecision(2) << GetLifeTime().As(unit);
+      *os << std::setw(16) << dest.str();
+      *os << std::setw(16) << gw.str();
+      *os << std::setw(16) << iface.str();
+      *os << std::setw(16);
+      switch (m_flag)
+      {
+      case VALID:
+      {
+        *os << "UP";
+        break;
+      }
+      case INVALID:
+      {
+        *os << "DOWN";
+        break;
+      }
+      case IN_SEARCH:
+      {
+        *os << "IN_SEARCH";
+        break;
+      }
+      }
+
+      *os << std::setw(16) << expire.str();
+      *os << m_hops << std::endl;
+      // Restore the previous ostream state
+      (*os).copyfmt(oldState);
+    }
+
+    /*
+     The Routing Table
+     */
+
+    RoutingTable::RoutingTable(Time t)
+        : m_badLinkLifetime(t),
+          m_generation(0)
+    {
+    }
+
+    bool
+    RoutingTable::LookupRoute(Ipv4Address id, RoutingTableEntry &rt)
+    {
+      NS_LOG_FUNCTION(this << id);
+      Purge();
+      if (m_ipv4AddressEntry.empty())
+      {
+        NS_LOG_LOGIC("Route to " << id << " not found; m_ipv4AddressEntry is empty");
+        return false;
+      }
+      std::map<Ipv4Address, RoutingTableEntry>::const_iterator i =
+          m_ipv4AddressEntry.find(id);
+      if (i == m_ipv4AddressEntry.end())
+      {
+        NS_LOG_LOGIC("Route to " << id << " not found");
+        return false;
+      }
+      rt = i->second;
+      NS_LOG_LOGIC("Route to " << id << " found");
+      return true;
+    }
+
+    bool
+    RoutingTable::LookupValidRoute(Ipv4Address id, RoutingTableEntry &rt)
+    {
+      NS_LOG_FUNCTION(this << id);
+      if (!LookupRoute(id, rt))
+      {
+        NS_LOG_LOGIC("Route to " << id << " not found");
+        return false;
+      }
+      NS_LOG_LOGIC("Route to " << id << " flag is " << ((rt.GetFlag() == VALID) ? "valid" : "not valid"));
+      return (rt.GetFlag() == VALID);
+    }
+
+    RoutingTableEntry *
+    RoutingTable::LookupRoute(Ipv4Address id)
+    {
+      NS_LOG_FUNCTION(this << id);
+      Purge();
+      std::map<Ipv4Address, RoutingTableEntry>::iterator i =
+          m_ipv4AddressEntry.find(id);
+      if (i == m_ipv4AddressEntry.end())
+      {
+        NS_LOG_LOGIC("Route to " << id << " not found");
+        return 0;
+      }
+      NS_LOG_LOGIC("Route to " << id << " found");
+      return &i->second;
+    }
+
+    RoutingTableEntry *
+    RoutingTable::AddOrLookupRoute(Ipv4Address id, bool &added)
+    {
+      NS_LOG_FUNCTION(this << id);
+      Purge();
+      std::map<Ipv4Address, RoutingTableEntry>::iterator i =
+          m_ipv4AddressEntry.lower_bound(id);
+      added = (i == m_ipv4AddressEntry.end() || i->first != id);
+      if (added)
+      {
+        NS_LOG_LOGIC("Route to " << id << " inserted");
+        i = m_ipv4AddressEntry.insert(i, std::make_pair(id, RoutingTableEntry()));
+        ++m_generation;
+      }
+      return &i->second;
+    }
+
+    void
+    RoutingTable::Commit(RoutingTableEntry *rt)
+    {
+      NS_LOG_FUNCTION(this << rt->GetDestination());
+      NS_ASSERT(m_ipv4AddressEntry.find(rt->GetDestination()) != m_ipv4AddressEntry.end());
+      ScheduleExpiry(*rt);
+      if (rt->GetFlag() != IN_SEARCH)
+      {
+        rt->SetRreqCnt(0);
+      }
+    }
+
+    RoutingTableEntry *
+    RoutingTable::LookupNextHopRoute(RoutingTableEntry *rt)
+    {
+      Ipv4Address nextHop = rt->GetNextHop();
+      if (rt->m_nextHopGeneration == m_generation && rt->m_nextHopEntry != 0 &&
+          rt->m_nextHopEntry->GetDestination() == nextHop)
+      {
+        return rt->m_nextHopEntry;
+      }
+      std::map<Ipv4Address, RoutingTableEntry>::iterator i = m_ipv4AddressEntry.find(nextHop);
+      rt->m_nextHopEntry = (i == m_ipv4AddressEntry.end()) ? 0 : &i->second;
+      rt->m_nextHopGeneration = m_generation;
+      return rt->m_nextHopEntry;
+    }
+
+    bool
+    RoutingTable::DeleteRoute(Ipv4Address dst)
+    {
+      NS_LOG_FUNCTION(this << dst);
+      Purge();
+      if (m_ipv4AddressEntry.erase(dst) != 0)
+      {
+        ++m_generation;
+        NS_LOG_LOGIC("Route deletion to " << dst << " successful");
+        return true;
+      }
+      NS_LOG_LOGIC("Route deletion to " << dst << " not successful");
+      return false;
+    }
+
+    bool
+    RoutingTable::AddRoute(RoutingTableEntry &rt)
+    {
+      NS_LOG_FUNCTION(this);
+      Purge();
+      if (rt.GetFlag() != IN_SEARCH)
+      {
+        rt.SetRreqCnt(0);
+      }
+      std::pair<std::map<Ipv4Address, RoutingTableEntry>::iterator, bool> result =
+          m_ipv4AddressEntry.insert(std::make_pair(rt.GetDestination(), rt));
+      if (result.second)
+      {
+        ++m_generation;
+        result.first->second.m_expiryKey = Time::Max();
+        ScheduleExpiry(result.first->second);
+      }
+      return result.second;
+    }
+
+    bool
+    RoutingTable::Update(RoutingTableEntry &rt)
+    {
+      NS_LOG_FUNCTION(this);
+      std::map<Ipv4Address, RoutingTableEntry>::iterator i =
+          m_ipv4AddressEntry.find(rt.GetDestination());
+      if (i == m_ipv4AddressEntry.end())
+      {
+        NS_LOG_LOGIC("Route update to " << rt.GetDestination() << " fails; not found");
+        return false;
+      }
+      // The caller's copy may carry an outdated heap key
+      Time expiryKey = i->second.m_expiryKey;
+      i->second = rt;
+      i->second.m_expiryKey = expiryKey;
+      ScheduleExpiry(i->second);
+      if (i->second.GetFlag() != IN_SEARCH)
+      {
+        NS_LOG_LOGIC("Route update to " << rt.GetDestination() << " set RreqCnt to 0");
+        i->second.SetRreqCnt(0);
+      }
+      return true;
+    }
+
+    bool
+    RoutingTable::SetEntryState(Ipv4Address id, RouteFlags state)
+    {
+      NS_LOG_FUNCTION(this);
+      std::map<Ipv4Address, RoutingTableEntry>::iterator i =
+          m_ipv4AddressEntry.find(id);
+      if (i == m_ipv4AddressEntry.end())
+      {
+        NS_LOG_LOGIC("Route set entry state to " << id << " fails; not found");
+        return false;
+      }
+      i->second.SetFlag(state);
+      i->second.SetRreqCnt(0);
+      ScheduleExpiry(i->second);
+      NS_LOG_LOGIC("Route set entry state to " << id << ": new state is " << state);
+      return true;
+    }
+
+    void
+    RoutingTable::GetListOfDestinationWithNextHop(Ipv4Address nextHop, std::map<Ipv4Address, uint32_t> &unreachable)
+    {
+      NS_LOG_FUNCTION(this);
+      Purge();
+      unreachable.clear();
+      for (std::map<Ipv4Address, RoutingTableEntry>::const_iterator i =
+               m_ipv4AddressEntry.begin();
+           i != m_ipv4AddressEntry.end(); ++i)
+      {
+        if (i->second.GetNextHop() == nextHop)
+        {
+          NS_LOG_LOGIC("Unreachable insert " << i->first << " " << i->second.GetSeqNo());
+          unreachable.insert(std::make_pair(i->first, i->second.GetSeqNo()));
+        }
+      }
+    }
+
+    void
+    RoutingTable::InvalidateRoutesWithDst(const std::map<Ipv4Address, uint32_t> &unreachable)
+    {
+      NS_LOG_FUNCTION(this);
+      Purge();
+      for (std::map<Ipv4Address, uint32_t>::const_iterator j =
+               unreachable.begin();
+           j != unreachable.end(); ++j)
+      {
+        std::map<Ipv4Address, RoutingTableEntry>::iterator i = m_ipv4AddressEntry.find(j->first);
+        if (i != m_ipv4AddressEntry.end() && i->second.GetFlag() == VALID)
+        {
+          NS_LOG_LOGIC("Invalidate route with destination address " << i->first);
+          i->second.Invalidate(m_badLinkLifetime);
+          ScheduleExpiry(i->second);
+        }
+      }
+    }
+
+    void
+    RoutingTable::DeleteAllRoutesFromInterface(Ipv4InterfaceAddress iface)
+    {
+      NS_LOG_FUNCTION(this);
+      if (m_ipv4AddressEntry.empty())
+      {
+        return;
+      }
+      for (std::map<Ipv4Address, RoutingTableEntry>::iterator i =
+               m_ipv4AddressEntry.begin();
+           i != m_ipv4AddressEntry.end();)
+      {
+        if (i->second.GetInterface() == iface)
+        {
+          std::map<Ipv4Address, RoutingTableEntry>::iterator tmp = i;
+          ++i;
+          m_ipv4AddressEntry.erase(tmp);
+          ++m_generation;
+        }
+        else
+        {
+          ++i;
+        }
+      }
+    }
+
+    void
+    RoutingTable::Clear()
+    {
+      m_ipv4AddressEntry.clear();
+      ++m_generation;
+      m_expiry = std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry>>();
+    }
+
+    void
+    RoutingTable::ScheduleExpiry(RoutingTableEntry &rt)
+    {
+      // An earlier node fires first and is re-keyed then
+      if (rt.m_lifeTime < rt.m_expiryKey)
+      {
+        rt.m_expiryKey = rt.m_lifeTime;
+        m_expiry.push(std::make_pair(rt.m_lifeTime, rt.GetDestination()));
+      }
+    }
+
+    void
+    RoutingTable::Purge()
+    {
+      Time now = Simulator::Now();
+      while (!m_expiry.empty() && m_expiry.top().first < now)
+      {
+        Expiry e = m_expiry.top();
+        m_expiry.pop();
+        std::map<Ipv4Address, RoutingTableEntry>::iterator i = m_ipv4AddressEntry.find(e.second);
+        if (i == m_ipv4AddressEntry.end() || i->second.m_expiryKey != e.first)
+        {
+          // Entry deleted, or superseded by an earlier node
+          continue;
+        }
+        RoutingTableEntry &rt = i->second;
+        rt.m_expiryKey = Time::Max();
+        // Fold in the uses recorded since the node was pushed
+        rt.m_lifeTime = std::max(rt.m_lifeTime, rt.m_activeUntil);
+        if (rt.m_lifeTime >= now)
+        {
+          // Lifetime was extended since the node was pushed
+          ScheduleExpiry(rt);
+        }
+        else if (rt.GetFlag() == INVALID)
+        {
+          m_ipv4AddressEntry.erase(i);
+          ++m_generation;
+        }
+        else if (rt.GetFlag() == VALID)
+        {
+          NS_LOG_LOGIC("Invalidate route with destination address " << i->first);
+          rt.Invalidate(m_badLinkLifetime);
+          ScheduleExpiry(rt);
+        }
+        // An expired IN_SEARCH entry stays until its state changes
+      }
+    }
+
+    void
+    RoutingTable::Purge(std::map<Ipv4Address, RoutingTableEntry> &table) const
+    {
+      NS_LOG_FUNCTION(this);
+      if (table.empty())
+      {
+        return;
+      }
+      for (std::map<Ipv4Address, RoutingTableEntry>::iterator i =
+               table.begin();
+           i != table.end();)
+      {
+        if (i->second.GetLifeTime() < Seconds(0))
+        {
+          if (i->second.GetFlag() == INVALID)
+          {
+            std::map<Ipv4Address, RoutingTableEntry>::iterator tmp = i;
+            ++i;
+            table.erase(tmp);
+          }
+          else if (i->second.GetFlag() == VALID)
+          {
+            NS_LOG_LOGIC("Invalidate route with destination address " << i->first);
+            i->second.Invalidate(m_badLinkLifetime);
+            ++i;
+          }
+          else
+          {
+            ++i;
+          }
+        }
+        else
+        {
+          ++i;
+        }
+      }
+    }
+
+    bool
+    RoutingTable::MarkLinkAsUnidirectional(Ipv4Address neighbor, Time blacklistTimeout)
+    {
+      NS_LOG_FUNCTION(this << neighbor << blacklistTimeout.As(Time::S));
+      std::map<Ipv4Address, RoutingTableEntry>::iterator i =
+          m_ipv4AddressEntry.find(neighbor);
+      if (i == m_ipv4AddressEntry.end())
+      {
+        NS_LOG_LOGIC("Mark link unidirectional to  " << neighbor << " fails; not found");
+        return false;
+      }
+      i->second.SetUnidirectional(true);
+      i->second.SetBlacklistTimeout(blacklistTimeout);
+      i->second.SetRreqCnt(0);
+      NS_LOG_LOGIC("Set link to " << neighbor << " to unidirectional");
+      return true;
+    }
+
+    void
+    RoutingTable::Print(Ptr<OutputStreamWrapper> stream, Time::Unit unit /* = Time::S */) const
+    {
+      std::map<Ipv4Address, RoutingTableEntry> table = m_ipv4AddressEntry;
+      Purge(table);
+      std::ostream *os = stream->GetStream();
+      // Copy the current ostream state
+      std::ios oldState(nullptr);
+      oldState.copyfmt(*os);
+
+      *os << std::resetiosflags(std::ios::adjustfield) << std::setiosflags(std::ios::left);
+      *os << "\nAODV Routing table\n";
+      *os << std::setw(16) << "Destination";
+      *os << std::setw(16) << "Gateway";
+      *os << std::setw(16) << "Interface";
+      *os << std::setw(16) << "Flag";
+      *os << std::setw(16) << "Expire";
+      *os << "Hops" << std::endl;
+      for (std::map<Ipv4Address, RoutingTableEntry>::const_iterator i =
+               table.begin();
+           i != table.end(); ++i)
+      {
+        i->second.Print(stream, unit);
+      }
+      *stream->GetStream() << "\n";
+    }
+
+  } // namespace aodv
+} // namespace ns3
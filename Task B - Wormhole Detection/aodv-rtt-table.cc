@@ -0,0 +1,333 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "aodv-rtt-table.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+
+namespace ns3
+{
+
+  NS_LOG_COMPONENT_DEFINE("AodvRttTable");
+
+  namespace aodv
+  {
+    /// Initial number of slots of either table, must be a power of two
+    static const uint32_t INITIAL_SLOTS = 16;
+    /// Node-wide samples required before any neighbor is judged
+    static const uint32_t MIN_SAMPLES = 4;
+
+    NS_OBJECT_ENSURE_REGISTERED(RrepReplierHeader);
+
+    RrepReplierHeader::RrepReplierHeader(uint8_t hops)
+        : m_hops(hops)
+    {
+    }
+
+    TypeId
+    RrepReplierHeader::GetTypeId()
+    {
+      static TypeId tid = TypeId("ns3::aodv::RrepReplierHeader")
+                              .SetParent<Header>()
+                              .SetGroupName("Aodv")
+                              .AddConstructor<RrepReplierHeader>();
+      return tid;
+    }
+
+    TypeId
+    RrepReplierHeader::GetInstanceTypeId() const
+    {
+      return GetTypeId();
+    }
+
+    uint32_t
+    RrepReplierHeader::GetSerializedSize() const
+    {
+      return 1;
+    }
+
+    void
+    RrepReplierHeader::Serialize(Buffer::Iterator i) const
+    {
+      i.WriteU8(m_hops);
+    }
+
+    uint32_t
+    RrepReplierHeader::Deserialize(Buffer::Iterator start)
+    {
+      Buffer::Iterator i = start;
+      m_hops = i.ReadU8();
+      return i.GetDistanceFrom(start);
+    }
+
+    void
+    RrepReplierHeader::Print(std::ostream &os) const
+    {
+      os << "Replier hops " << static_cast<uint32_t>(m_hops);
+    }
+
+    NeighborRttTable::NeighborRttTable(Time pendingTimeout, uint32_t factor)
+        : m_nb(INITIAL_SLOTS),
+          m_nbCount(0),
+          m_pending(INITIAL_SLOTS),
+          m_pendingCount(0),
+          m_pendingTimeout(pendingTimeout),
+          m_factor(factor),
+          m_srtt(0),
+          m_rttvar(0),
+          m_nSamples(0)
+    {
+      Clear();
+    }
+
+    uint32_t
+    NeighborRttTable::Hash(uint64_t key)
+    {
+      key ^= key >> 33;
+      key *= 0xff51afd7ed558ccdULL;
+      key ^= key >> 33;
+      return static_cast<uint32_t>(key);
+    }
+
+    int64_t
+    NeighborRttTable::Update(int64_t &srtt, int64_t &rttvar, uint32_t &n, int64_t m)
+    {
+      if (n++ == 0)
+      {
+        srtt = m;
+        rttvar = m / 2;
+        return 0;
+      }
+      // Same recurrence as RttMeanDeviation::IntegerUpdate with alpha = 1/8, beta = 1/4
+      int64_t delta = m - srtt;
+      srtt += delta >> 3;
+      int64_t err = (delta < 0 ? -delta : delta) - rttvar;
+      rttvar += err >> 2;
+      return delta;
+    }
+
+    void
+    NeighborRttTable::NotifyRequestSent(Ipv4Address origin, Ipv4Address dst)
+    {
+      uint64_t key = (static_cast<uint64_t>(origin.Get()) << 32) | dst.Get();
+      if (2 * (m_pendingCount + 1) > m_pending.size())
+      {
+        RehashPending();
+      }
+      uint32_t mask = m_pending.size() - 1;
+      for (uint32_t i = Hash(key) & mask;; i = (i + 1) & mask)
+      {
+        Pending &p = m_pending[i];
+        if (!p.m_used)
+        {
+          p.m_key = key;
+          p.m_used = true;
+          p.m_sent = Simulator::Now();
+          m_pendingCount++;
+          return;
+        }
+        if (p.m_key == key)
+        {
+          // Retried or rebroadcast discovery: time the latest attempt
+          p.m_sent = Simulator::Now();
+          return;
+        }
+      }
+    }
+
+    bool
+    NeighborRttTable::NotifyReply(Ipv4Address origin, Ipv4Address dst, Ipv4Address neighbor, uint16_t hops, Time &perHop)
+    {
+      uint64_t key = (static_cast<uint64_t>(origin.Get()) << 32) | dst.Get();
+      uint32_t mask = m_pending.size() - 1;
+      uint32_t i = Hash(key) & mask;
+      while (m_pending[i].m_used && m_pending[i].m_key != key)
+      {
+        i = (i + 1) & mask;
+      }
+      if (!m_pending[i].m_used)
+      {
+        return false;
+      }
+      Time rtt = Simulator::Now() - m_pending[i].m_sent;
+      ErasePending(i);
+      if (rtt > m_pendingTimeout || hops == 0)
+      {
+        return false;
+      }
+
+      int64_t m = rtt.GetInteger() / hops;
+      perHop = Time::From(m);
+      Slot &s = FindOrInsert(neighbor);
+      s.m_rtt.m_lastSample = m;
+      s.m_rtt.m_delta = Update(s.m_rtt.m_srtt, s.m_rtt.m_rttvar, s.m_rtt.m_nSamples, m);
+      s.m_rtt.m_suspect = m_nSamples >= MIN_SAMPLES &&
+                          s.m_rtt.m_srtt > m_srtt + static_cast<int64_t>(m_factor) * m_rttvar;
+      Update(m_srtt, m_rttvar, m_nSamples, m);
+      NS_LOG_LOGIC("Per-hop RTT sample " << perHop.As(Time::MS) << " via " << neighbor
+                                         << " srtt " << Time::From(s.m_rtt.m_srtt).As(Time::MS));
+      return true;
+    }
+
+    NeighborRtt const *
+    NeighborRttTable::Lookup(Ipv4Address neighbor) const
+    {
+      uint32_t mask = m_nb.size() - 1;
+      for (uint32_t i = Hash(neighbor.Get()) & mask; m_nb[i].m_used; i = (i + 1) & mask)
+      {
+        if (m_nb[i].m_rtt.m_neighbor == neighbor)
+        {
+          return &m_nb[i].m_rtt;
+        }
+      }
+      return 0;
+    }
+
+    void
+    NeighborRttTable::Clear()
+    {
+      for (std::vector<Slot>::iterator i = m_nb.begin(); i != m_nb.end(); ++i)
+      {
+        i->m_used = false;
+      }
+      for (std::vector<Pending>::iterator i = m_pending.begin(); i != m_pending.end(); ++i)
+      {
+        i->m_used = false;
+      }
+      m_nbCount = 0;
+      m_pendingCount = 0;
+      m_srtt = 0;
+      m_rttvar = 0;
+      m_nSamples = 0;
+    }
+
+    NeighborRttTable::Slot &
+    NeighborRttTable::FindOrInsert(Ipv4Address neighbor)
+    {
+      if (2 * (m_nbCount + 1) > m_nb.size())
+      {
+        GrowNeighbors();
+      }
+      uint32_t mask = m_nb.size() - 1;
+      uint32_t i = Hash(neighbor.Get()) & mask;
+      while (m_nb[i].m_used)
+      {
+        if (m_nb[i].m_rtt.m_neighbor == neighbor)
+        {
+          return m_nb[i];
+        }
+        i = (i + 1) & mask;
+      }
+      Slot &s = m_nb[i];
+      s.m_used = true;
+      s.m_rtt.m_neighbor = neighbor;
+      s.m_rtt.m_srtt = 0;
+      s.m_rtt.m_rttvar = 0;
+      s.m_rtt.m_lastSample = 0;
+      s.m_rtt.m_delta = 0;
+      s.m_rtt.m_nSamples = 0;
+      s.m_rtt.m_suspect = false;
+      m_nbCount++;
+      return s;
+    }
+
+    void
+    NeighborRttTable::GrowNeighbors()
+    {
+      std::vector<Slot> old(m_nb.size() * 2);
+      old.swap(m_nb);
+      for (std::vector<Slot>::iterator i = m_nb.begin(); i != m_nb.end(); ++i)
+      {
+        i->m_used = false;
+      }
+      uint32_t mask = m_nb.size() - 1;
+      for (std::vector<Slot>::const_iterator i = old.begin(); i != old.end(); ++i)
+      {
+        if (!i->m_used)
+        {
+          continue;
+        }
+        uint32_t j = Hash(i->m_rtt.m_neighbor.Get()) & mask;
+        while (m_nb[j].m_used)
+        {
+          j = (j + 1) & mask;
+        }
+        m_nb[j] = *i;
+      }
+    }
+
+    void
+    NeighborRttTable::RehashPending()
+    {
+      Time now = Simulator::Now();
+      uint32_t live = 0;
+      for (std::vector<Pending>::const_iterator i = m_pending.begin(); i != m_pending.end(); ++i)
+      {
+        if (i->m_used && now - i->m_sent <= m_pendingTimeout)
+        {
+          live++;
+        }
+      }
+      // Keep the size when purging timed out entries frees enough room
+      uint32_t size = m_pending.size();
+      while (4 * (live + 1) > size)
+      {
+        size *= 2;
+      }
+      std::vector<Pending> old(size);
+      old.swap(m_pending);
+      for (std::vector<Pending>::iterator i = m_pending.begin(); i != m_pending.end(); ++i)
+      {
+        i->m_used = false;
+      }
+      uint32_t mask = size - 1;
+      for (std::vector<Pending>::const_iterator i = old.begin(); i != old.end(); ++i)
+      {
+        if (!i->m_used || now - i->m_sent > m_pendingTimeout)
+        {
+          continue;
+        }
+        uint32_t j = Hash(i->m_key) & mask;
+        while (m_pending[j].m_used)
+        {
+          j = (j + 1) & mask;
+        }
+        m_pending[j] = *i;
+      }
+      m_pendingCount = live;
+    }
+
+    void
+    NeighborRttTable::ErasePending(uint32_t i)
+    {
+      uint32_t mask = m_pending.size() - 1;
+      m_pending[i].m_used = false;
+      m_pendingCount--;
+      // Shift back following entries of the probe run so lookups never stop early
+      for (uint32_t j = (i + 1) & mask; m_pending[j].m_used; j = (j + 1) & mask)
+      {
+        uint32_t home = Hash(m_pending[j].m_key) & mask;
+        if (((j - home) & mask) >= ((j - i) & mask))
+        {
+          m_pending[i] = m_pending[j];
+          m_pending[j].m_used = false;
+          i = j;
+        }
+      }
+    }
+
+  } // namespace aodv
+} // namespace ns3
@@ -0,0 +1,242 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef AODV_RTT_TABLE_H
+#define AODV_RTT_TABLE_H
+
+#include "ns3/header.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include <stdint.h>
+#include <vector>
+
+namespace ns3
+{
+  namespace aodv
+  {
+    /**
+     * \ingroup aodv
+     * \brief Hop count carried after the RREP header of a reply sent from a route cache
+     *
+      \verbatim
+      0 1 2 3 4 5 6 7
+     +-+-+-+-+-+-+-+-+
+     |  Replier Hops |
+     +-+-+-+-+-+-+-+-+
+      \endverbatim
+     *
+     * An intermediate node answering a RREQ from its route table starts the
+     * RREP hop count at its own distance to the destination, while the RREP
+     * round trip only covers the hops up to that node. Nodes on the way back
+     * subtract the hop count the RREP left its replier with to time the hops
+     * that were actually travelled. A RREP without it comes from the
+     * destination itself.
+     */
+    class RrepReplierHeader : public Header
+    {
+    public:
+      /**
+       * constructor
+       * \param hops the RREP hop count when it left the replier
+       */
+      RrepReplierHeader(uint8_t hops = 0);
+
+      /**
+       * \brief Get the type ID.
+       * \return the object TypeId
+       */
+      static TypeId GetTypeId();
+      TypeId GetInstanceTypeId() const;
+      uint32_t GetSerializedSize() const;
+      void Serialize(Buffer::Iterator start) const;
+      uint32_t Deserialize(Buffer::Iterator start);
+      void Print(std::ostream &os) const;
+
+      /**
+       * Get the replier hop count
+       * \returns the RREP hop count when it left the replier
+       */
+      uint8_t GetHops() const
+      {
+        return m_hops;
+      }
+
+    private:
+      uint8_t m_hops; ///< RREP hop count when it left the replier
+    };
+
+    /**
+     * \ingroup aodv
+     * \brief Per-neighbor RTT state, all values in Time integer units
+     */
+    struct NeighborRtt
+    {
+      Ipv4Address m_neighbor; ///< neighbor address
+      int64_t m_srtt;         ///< smoothed per-hop RTT
+      int64_t m_rttvar;       ///< mean deviation of the per-hop RTT
+      int64_t m_lastSample;   ///< last per-hop RTT sample
+      int64_t m_delta;        ///< last sample minus the estimate it was compared against
+      uint32_t m_nSamples;    ///< number of samples
+      bool m_suspect;         ///< neighbor exceeded the suspicion bound at its last sample
+    };
+
+    /**
+     * \ingroup aodv
+     * \brief Per-neighbor RTT estimator table fed by RREQ/RREP exchanges
+     *
+     * Every RREQ this node originates or rebroadcasts is timestamped under
+     * its (origin, destination) pair. When the matching RREP comes back
+     * through a neighbor, the elapsed time divided by the hops from this
+     * node to the node that sent the RREP is a per-hop RTT sample for that
+     * neighbor. Samples are smoothed with the
+     * Jacobson/Karels integer recurrence used by RttMeanDeviation (alpha =
+     * 1/8, beta = 1/4), both per neighbor and node-wide, so that a neighbor
+     * whose per-hop RTT sits well above the node-wide estimate can be
+     * flagged as a possible wormhole end at O(1) cost per control packet.
+     * The bound is evaluated before the sample is folded into the node-wide
+     * estimate, so a single long sample cannot hide itself.
+     *
+     * Both tables are open-addressed with linear probing over a
+     * power-of-two slot array.
+     */
+    class NeighborRttTable
+    {
+    public:
+      /**
+       * constructor
+       * \param pendingTimeout time after which an unanswered RREQ timestamp is discarded
+       * \param factor node-wide mean deviations a neighbor smoothed RTT may exceed the node-wide one by
+       */
+      NeighborRttTable(Time pendingTimeout, uint32_t factor);
+
+      /**
+       * Remember that a RREQ for (origin, dst) left this node now
+       * \param origin RREQ originator
+       * \param dst RREQ destination
+       */
+      void NotifyRequestSent(Ipv4Address origin, Ipv4Address dst);
+      /**
+       * Match a RREP against an outstanding RREQ and, on success, feed the
+       * resulting per-hop sample into the entry of the neighbor it came from
+       * \param origin RREP origin (the RREQ originator)
+       * \param dst RREP destination
+       * \param neighbor neighbor the RREP was received from
+       * \param hops hop count from this node to the node that sent the RREP,
+       *        which is dst unless an intermediate node replied from its route table
+       * \param perHop [out] the per-hop RTT sample
+       * \return true if an outstanding RREQ was found and a sample was taken
+       */
+      bool NotifyReply(Ipv4Address origin, Ipv4Address dst, Ipv4Address neighbor, uint16_t hops, Time &perHop);
+      /**
+       * Lookup RTT state of a neighbor
+       * \param neighbor the neighbor address
+       * \return the entry or 0 if no sample was taken for this neighbor
+       */
+      NeighborRtt const *Lookup(Ipv4Address neighbor) const;
+      /// \return the node-wide smoothed per-hop RTT
+      Time GetSrtt() const
+      {
+        return Time::From(m_srtt);
+      }
+      /// \return the node-wide per-hop RTT mean deviation
+      Time GetRttvar() const
+      {
+        return Time::From(m_rttvar);
+      }
+      /// \return number of neighbors with RTT state
+      uint32_t GetSize() const
+      {
+        return m_nbCount;
+      }
+      /// Remove all neighbors and outstanding requests
+      void Clear();
+      /**
+       * Set pending RREQ timeout
+       * \param t the timeout
+       */
+      void SetPendingTimeout(Time t)
+      {
+        m_pendingTimeout = t;
+      }
+      /**
+       * Set suspicion factor
+       * \param factor node-wide mean deviations a neighbor smoothed RTT may exceed the node-wide one by
+       */
+      void SetSuspicionFactor(uint32_t factor)
+      {
+        m_factor = factor;
+      }
+
+    private:
+      /// Outstanding RREQ slot
+      struct Pending
+      {
+        uint64_t m_key; ///< (origin << 32) | dst
+        Time m_sent;    ///< absolute send time
+        bool m_used;    ///< slot occupied
+      };
+      /// Neighbor slot
+      struct Slot
+      {
+        NeighborRtt m_rtt; ///< RTT state
+        bool m_used;       ///< slot occupied
+      };
+
+      /**
+       * Apply one Jacobson/Karels step
+       * \param srtt smoothed RTT, updated
+       * \param rttvar RTT mean deviation, updated
+       * \param n number of samples, updated
+       * \param m the sample
+       * \return the sample minus the previous estimate
+       */
+      static int64_t Update(int64_t &srtt, int64_t &rttvar, uint32_t &n, int64_t m);
+      /**
+       * Mix a key into a slot index
+       * \param key the key
+       * \return hash of the key
+       */
+      static uint32_t Hash(uint64_t key);
+      /**
+       * Find or create the neighbor slot
+       * \param neighbor the neighbor address
+       * \return the slot
+       */
+      Slot &FindOrInsert(Ipv4Address neighbor);
+      /// Double the neighbor slot array
+      void GrowNeighbors();
+      /// Rebuild the pending slot array, dropping timed out entries
+      void RehashPending();
+      /**
+       * Erase pending slot using backward-shift deletion
+       * \param i slot index
+       */
+      void ErasePending(uint32_t i);
+
+      std::vector<Slot> m_nb;           ///< neighbor slots
+      uint32_t m_nbCount;               ///< occupied neighbor slots
+      std::vector<Pending> m_pending;   ///< outstanding RREQ slots
+      uint32_t m_pendingCount;          ///< occupied pending slots
+      Time m_pendingTimeout;            ///< lifetime of an unanswered RREQ timestamp
+      uint32_t m_factor;                ///< suspicion bound in node-wide mean deviations
+      int64_t m_srtt;                   ///< node-wide smoothed per-hop RTT
+      int64_t m_rttvar;                 ///< node-wide per-hop RTT mean deviation
+      uint32_t m_nSamples;              ///< node-wide number of samples
+    };
+
+  } // namespace aodv
+} // namespace ns3
+
+#endif /* AODV_RTT_TABLE_H */
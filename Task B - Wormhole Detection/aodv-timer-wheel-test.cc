@@ -0,0 +1,218 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/test.h"
+#include "ns3/aodv-timer-wheel.h"
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
+#include <vector>
+
+using namespace ns3;
+using namespace aodv;
+
+/**
+ * \ingroup aodv-test
+ * \ingroup tests
+ *
+ * \brief Timer wheel Test
+ *
+ * Timers must fire on the first tick not before their expiry, in the
+ * order they were scheduled when they share a tick, cancelled timers
+ * must not fire, and timers beyond the first levels must come down the
+ * wheel and fire on time.
+ */
+class AodvTimerWheelTestCase : public TestCase
+{
+public:
+  AodvTimerWheelTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \brief Record a firing timer
+   * \param test the test case
+   * \param id the test's timer number
+   */
+  static void Fire (AodvTimerWheelTestCase *test, uint32_t id);
+  /**
+   * \brief Schedule a test timer
+   * \param id the test's timer number
+   * \param delay the delay
+   * \returns the wheel timer id
+   */
+  uint64_t Add (uint32_t id, Time delay);
+  /// Check the timers pending halfway
+  void CheckPending (void);
+
+  Ptr<TimerWheel> m_wheel;        //!< Wheel under test
+  std::vector<uint32_t> m_fired;  //!< Test timer numbers in firing order
+  std::vector<Time> m_firedAt;    //!< Firing times, by test timer number
+  uint64_t m_long;                //!< Wheel id of the long timer
+};
+
+AodvTimerWheelTestCase::AodvTimerWheelTestCase ()
+  : TestCase ("Timer wheel"),
+    m_firedAt (8),
+    m_long (0)
+{
+}
+
+void
+AodvTimerWheelTestCase::Fire (AodvTimerWheelTestCase *test, uint32_t id)
+{
+  test->m_fired.push_back (id);
+  test->m_firedAt[id] = Simulator::Now ();
+}
+
+uint64_t
+AodvTimerWheelTestCase::Add (uint32_t id, Time delay)
+{
+  return m_wheel->Schedule (delay, MakeBoundCallback (&AodvTimerWheelTestCase::Fire, this, id));
+}
+
+void
+AodvTimerWheelTestCase::CheckPending (void)
+{
+  NS_TEST_ASSERT_MSG_EQ (m_wheel->IsPending (m_long), true, "long timer pending");
+  NS_TEST_ASSERT_MSG_EQ (m_wheel->GetDelayLeft (m_long), Seconds (100), "long timer delay left");
+}
+
+void
+AodvTimerWheelTestCase::DoRun (void)
+{
+  m_wheel = TimerWheel::GetShared (MilliSeconds (10));
+  NS_TEST_ASSERT_MSG_EQ (m_wheel, TimerWheel::GetShared (MilliSeconds (10)), "one wheel per granularity");
+
+  Add (0, MilliSeconds (25));
+  Add (1, MilliSeconds (21));
+  Add (2, MilliSeconds (30));
+  uint64_t cancelled = Add (3, MilliSeconds (20));
+  Add (4, MilliSeconds (0));
+  Add (5, Seconds (1));
+  m_long = Add (6, Seconds (200));
+  NS_TEST_ASSERT_MSG_EQ (m_wheel->GetSize (), 7, "seven timers pending");
+  NS_TEST_ASSERT_MSG_EQ (m_wheel->GetDelayLeft (cancelled), MilliSeconds (20), "delay left on a tick");
+  m_wheel->Cancel (cancelled);
+  m_wheel->Cancel (cancelled);
+  NS_TEST_ASSERT_MSG_EQ (m_wheel->IsPending (cancelled), false, "cancelled timer gone");
+  NS_TEST_ASSERT_MSG_EQ (m_wheel->GetDelayLeft (cancelled), Seconds (0), "no delay left once cancelled");
+  Simulator::Schedule (Seconds (100), &AodvTimerWheelTestCase::CheckPending, this);
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_fired.size (), 6, "all timers but the cancelled one fired");
+  NS_TEST_ASSERT_MSG_EQ (m_fired[0], 4, "timer without delay first");
+  // Timers 0 and 1 share the 30 ms tick with timer 2 and keep their order
+  NS_TEST_ASSERT_MSG_EQ (m_fired[1], 0, "first timer of the tick");
+  NS_TEST_ASSERT_MSG_EQ (m_fired[2], 1, "second timer of the tick");
+  NS_TEST_ASSERT_MSG_EQ (m_fired[3], 2, "third timer of the tick");
+  NS_TEST_ASSERT_MSG_EQ (m_firedAt[0], MilliSeconds (30), "25 ms rounded up to the tick");
+  NS_TEST_ASSERT_MSG_EQ (m_firedAt[1], MilliSeconds (30), "21 ms rounded up to the tick");
+  NS_TEST_ASSERT_MSG_EQ (m_firedAt[4], Seconds (0), "no delay fires now");
+  NS_TEST_ASSERT_MSG_EQ (m_firedAt[5], Seconds (1), "timer on a higher level fires on time");
+  NS_TEST_ASSERT_MSG_EQ (m_firedAt[6], Seconds (200), "long timer fires on time");
+  NS_TEST_ASSERT_MSG_EQ (m_wheel->GetSize (), 0, "wheel empty");
+  m_wheel = 0;
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup aodv-test
+ * \ingroup tests
+ *
+ * \brief Wheel timer Test
+ *
+ * A timer on a wheel must report its state like a plain Timer, expire in
+ * the node context it was scheduled from and be able to rearm itself from
+ * its callback.
+ */
+class AodvWheelTimerTestCase : public TestCase
+{
+public:
+  AodvWheelTimerTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /// Schedule the timer from a node context
+  void Start (void);
+  /// Count an expiry and rearm the timer five times
+  void Expire (void);
+
+  WheelTimer m_timer;  //!< Timer under test
+  uint32_t m_expired;  //!< Expiries so far
+};
+
+AodvWheelTimerTestCase::AodvWheelTimerTestCase ()
+  : TestCase ("Wheel timer"),
+    m_expired (0)
+{
+}
+
+void
+AodvWheelTimerTestCase::Start (void)
+{
+  m_timer.Schedule (Seconds (1));
+}
+
+void
+AodvWheelTimerTestCase::Expire (void)
+{
+  NS_TEST_ASSERT_MSG_EQ (m_timer.IsRunning (), false, "timer not running in its callback");
+  NS_TEST_ASSERT_MSG_EQ (Simulator::GetContext (), 3, "timer expired in its node context");
+  if (++m_expired < 5)
+    {
+      m_timer.Schedule (Seconds (1));
+    }
+}
+
+void
+AodvWheelTimerTestCase::DoRun (void)
+{
+  m_timer.SetWheel (TimerWheel::GetShared (MilliSeconds (10)));
+  m_timer.SetFunction (&AodvWheelTimerTestCase::Expire, this);
+  m_timer.Schedule (MilliSeconds (5));
+  NS_TEST_ASSERT_MSG_EQ (m_timer.IsRunning (), true, "timer running");
+  NS_TEST_ASSERT_MSG_EQ (m_timer.GetDelayLeft (), MilliSeconds (10), "delay rounded up to the tick");
+  m_timer.Cancel ();
+  NS_TEST_ASSERT_MSG_EQ (m_timer.IsRunning (), false, "timer cancelled");
+  Simulator::ScheduleWithContext (3, Seconds (0), &AodvWheelTimerTestCase::Start, this);
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (m_expired, 5, "periodic timer expired five times");
+  NS_TEST_ASSERT_MSG_EQ (Simulator::Now (), Seconds (5), "last expiry on time");
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup aodv-test
+ * \ingroup tests
+ *
+ * \brief AODV timer wheel TestSuite
+ */
+class AodvTimerWheelTestSuite : public TestSuite
+{
+public:
+  AodvTimerWheelTestSuite ()
+    : TestSuite ("aodv-timer-wheel", UNIT)
+  {
+    AddTestCase (new AodvTimerWheelTestCase, TestCase::QUICK);
+    AddTestCase (new AodvWheelTimerTestCase, TestCase::QUICK);
+  }
+
+};
+
+static AodvTimerWheelTestSuite g_aodvTimerWheelTestSuite; //!< Static variable for test initialization
@@ -0,0 +1,357 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "aodv-timer-wheel.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include <algorithm>
+
+namespace ns3
+{
+
+  NS_LOG_COMPONENT_DEFINE("AodvTimerWheel");
+
+  namespace aodv
+  {
+    /// Shared wheels of the current simulation, by tick length
+    static std::map<int64_t, Ptr<TimerWheel>> &
+    SharedWheels()
+    {
+      static std::map<int64_t, Ptr<TimerWheel>> wheels;
+      return wheels;
+    }
+
+    TimerWheel::TimerWheel(Time granularity)
+        : m_granularity(granularity),
+          m_current(0),
+          m_nextId(1),
+          m_levelSize(),
+          m_armed(false),
+          m_eventTick(0)
+    {
+      NS_ASSERT_MSG(granularity.IsStrictlyPositive(), "Timer wheel granularity must be positive");
+      m_current = TickOf(Simulator::Now());
+    }
+
+    Ptr<TimerWheel>
+    TimerWheel::GetShared(Time granularity)
+    {
+      std::map<int64_t, Ptr<TimerWheel>> &wheels = SharedWheels();
+      if (wheels.empty())
+      {
+        Simulator::ScheduleDestroy(&TimerWheel::DestroyShared);
+      }
+      Ptr<TimerWheel> &wheel = wheels[granularity.GetTimeStep()];
+      if (wheel == 0)
+      {
+        wheel = Create<TimerWheel>(granularity);
+      }
+      return wheel;
+    }
+
+    void
+    TimerWheel::DestroyShared()
+    {
+      SharedWheels().clear();
+    }
+
+    uint64_t
+    TimerWheel::TickOf(Time t) const
+    {
+      int64_t step = m_granularity.GetTimeStep();
+      return (t.GetTimeStep() + step - 1) / step;
+    }
+
+    uint64_t
+    TimerWheel::Schedule(Time delay, Callback<void> callback)
+    {
+      NS_LOG_FUNCTION(this << delay);
+      NS_ASSERT(!delay.IsStrictlyNegative());
+      if (m_index.empty())
+      {
+        // An idle wheel restarts from now rather than walking the ticks it slept through
+        m_armed = false;
+        m_current = std::max(m_current, TickOf(Simulator::Now()));
+      }
+      Entry entry;
+      entry.m_id = m_nextId++;
+      entry.m_expire = std::max(TickOf(Simulator::Now() + delay), m_current);
+      entry.m_context = Simulator::GetContext();
+      entry.m_callback = callback;
+      // A slot of a higher level can cascade before the armed tick even if
+      // the timer itself expires after it
+      uint64_t due = Insert(entry);
+      if (!m_armed || due < m_eventTick)
+      {
+        ScheduleNext();
+      }
+      return entry.m_id;
+    }
+
+    void
+    TimerWheel::Cancel(uint64_t id)
+    {
+      std::map<uint64_t, Location>::iterator i = m_index.find(id);
+      if (i == m_index.end())
+      {
+        return;
+      }
+      if (i->second.m_slot == DUE_SLOT)
+      {
+        m_due[i->second.m_entry->m_context].erase(i->second.m_entry);
+      }
+      else
+      {
+        m_slots[i->second.m_slot].erase(i->second.m_entry);
+        --m_levelSize[i->second.m_slot / LEVEL_SLOTS];
+      }
+      m_index.erase(i);
+      // A stale event finds nothing to do and rearms for the next busy tick
+    }
+
+    bool
+    TimerWheel::IsPending(uint64_t id) const
+    {
+      return m_index.find(id) != m_index.end();
+    }
+
+    Time
+    TimerWheel::GetDelayLeft(uint64_t id) const
+    {
+      std::map<uint64_t, Location>::const_iterator i = m_index.find(id);
+      if (i == m_index.end())
+      {
+        return Seconds(0);
+      }
+      Time expire = TimeStep(m_granularity.GetTimeStep() * i->second.m_entry->m_expire);
+      return std::max(expire - Simulator::Now(), Seconds(0));
+    }
+
+    uint64_t
+    TimerWheel::Insert(Entry const &entry)
+    {
+      uint64_t delta = entry.m_expire - m_current;
+      uint32_t level = 0;
+      while (level < LEVELS - 1 && delta >> ((level + 1) * LEVEL_BITS) != 0)
+      {
+        ++level;
+      }
+      uint64_t expire = entry.m_expire;
+      if (delta >> (LEVELS * LEVEL_BITS) != 0)
+      {
+        // Beyond the top level: wait in its farthest slot and get placed again
+        expire = m_current + (uint64_t(1) << (LEVELS * LEVEL_BITS)) - 1;
+      }
+      uint32_t slot = level * LEVEL_SLOTS + ((expire >> (level * LEVEL_BITS)) & (LEVEL_SLOTS - 1));
+      std::list<Entry> &list = m_slots[slot];
+      Location location;
+      location.m_slot = slot;
+      location.m_entry = list.insert(list.end(), entry);
+      m_index[entry.m_id] = location;
+      ++m_levelSize[level];
+      return expire >> (level * LEVEL_BITS) << (level * LEVEL_BITS);
+    }
+
+    void
+    TimerWheel::Cascade(uint32_t level, uint32_t index)
+    {
+      std::list<Entry> entries;
+      entries.swap(m_slots[level * LEVEL_SLOTS + index]);
+      m_levelSize[level] -= entries.size();
+      for (std::list<Entry>::const_iterator i = entries.begin(); i != entries.end(); ++i)
+      {
+        Insert(*i);
+      }
+    }
+
+    void
+    TimerWheel::Tick(uint64_t tick)
+    {
+      if (!m_armed || tick != m_eventTick)
+      {
+        return;
+      }
+      NS_LOG_FUNCTION(this << tick);
+      m_current = tick;
+      uint32_t index = tick & (LEVEL_SLOTS - 1);
+      for (uint32_t level = 1; level < LEVELS && index == 0; ++level)
+      {
+        index = (tick >> (level * LEVEL_BITS)) & (LEVEL_SLOTS - 1);
+        Cascade(level, index);
+      }
+      // Timers stay cancellable until their batch runs
+      std::list<Entry> &due = m_slots[tick & (LEVEL_SLOTS - 1)];
+      m_levelSize[0] -= due.size();
+      while (!due.empty())
+      {
+        std::list<Entry> &batch = m_due[due.front().m_context];
+        if (batch.empty())
+        {
+          Simulator::ScheduleWithContext(due.front().m_context, Seconds(0), &TimerWheel::Dispatch, this,
+                                         due.front().m_context);
+        }
+        batch.splice(batch.end(), due, due.begin());
+        Location &location = m_index[batch.back().m_id];
+        location.m_slot = DUE_SLOT;
+        location.m_entry = --batch.end();
+      }
+      m_current = tick + 1;
+      ScheduleNext();
+    }
+
+    void
+    TimerWheel::Dispatch(uint32_t context)
+    {
+      NS_LOG_FUNCTION(this << context);
+      std::map<uint32_t, std::list<Entry>>::iterator batch = m_due.find(context);
+      if (batch == m_due.end())
+      {
+        return;
+      }
+      // One entry at a time, so that a callback may cancel a later entry
+      while (!batch->second.empty())
+      {
+        Entry entry = batch->second.front();
+        batch->second.pop_front();
+        m_index.erase(entry.m_id);
+        entry.m_callback();
+      }
+      m_due.erase(batch);
+    }
+
+    bool
+    TimerWheel::IsBusy(uint64_t tick) const
+    {
+      uint32_t index = tick & (LEVEL_SLOTS - 1);
+      if (!m_slots[index].empty())
+      {
+        return true;
+      }
+      for (uint32_t level = 1; level < LEVELS && index == 0; ++level)
+      {
+        index = (tick >> (level * LEVEL_BITS)) & (LEVEL_SLOTS - 1);
+        if (!m_slots[level * LEVEL_SLOTS + index].empty())
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void
+    TimerWheel::ScheduleNext()
+    {
+      // Only ticks aligned to the lowest non-empty level can have work, and
+      // one of them within a turn of that level does
+      uint32_t low = 0;
+      while (low < LEVELS && m_levelSize[low] == 0)
+      {
+        ++low;
+      }
+      if (low == LEVELS)
+      {
+        m_armed = false;
+        return;
+      }
+      uint64_t step = uint64_t(1) << (low * LEVEL_BITS);
+      uint64_t next = (m_current + step - 1) / step * step;
+      while (!IsBusy(next))
+      {
+        next += step;
+      }
+      if (m_armed && m_eventTick == next)
+      {
+        return;
+      }
+      m_armed = true;
+      m_eventTick = next;
+      Time at = TimeStep(m_granularity.GetTimeStep() * next);
+      Simulator::ScheduleWithContext(Simulator::NO_CONTEXT, std::max(at - Simulator::Now(), Seconds(0)),
+                                     &TimerWheel::Tick, this, next);
+    }
+
+    WheelTimer::WheelTimer()
+        : m_timer(Timer::CANCEL_ON_DESTROY),
+          m_id(0)
+    {
+    }
+
+    WheelTimer::~WheelTimer()
+    {
+      Cancel();
+    }
+
+    void
+    WheelTimer::SetWheel(Ptr<TimerWheel> wheel)
+    {
+      NS_ASSERT_MSG(!IsRunning(), "Cannot move a running timer to another wheel");
+      m_wheel = wheel;
+    }
+
+    void
+    WheelTimer::Schedule(Time delay)
+    {
+      if (m_wheel == 0)
+      {
+        m_timer.Schedule(delay);
+        return;
+      }
+      if (m_id != 0)
+      {
+        NS_FATAL_ERROR("Event is still running while re-scheduling.");
+      }
+      m_id = m_wheel->Schedule(delay, MakeCallback(&WheelTimer::Expire, this));
+    }
+
+    void
+    WheelTimer::Cancel()
+    {
+      if (m_wheel != 0 && m_id != 0)
+      {
+        m_wheel->Cancel(m_id);
+        m_id = 0;
+      }
+      m_timer.Cancel();
+    }
+
+    bool
+    WheelTimer::IsRunning() const
+    {
+      if (m_wheel == 0)
+      {
+        return m_timer.IsRunning();
+      }
+      return m_id != 0;
+    }
+
+    Time
+    WheelTimer::GetDelayLeft() const
+    {
+      if (m_wheel == 0)
+      {
+        return m_timer.GetDelayLeft();
+      }
+      return m_wheel->GetDelayLeft(m_id);
+    }
+
+    void
+    WheelTimer::Expire()
+    {
+      m_id = 0;
+      m_callback();
+    }
+
+  } // namespace aodv
+} // namespace ns3
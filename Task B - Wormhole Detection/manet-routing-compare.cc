@@ -57,16 +57,19 @@
  * to the end of the simulation.
  *
  * The program outputs a few items:
- * - packet receptions are notified to stdout such as:
+ * - with --verbose, packet receptions are notified to stdout such as:
  *   <timestamp> <node-id> received one packet from <src-address>
- * - each second, the data reception statistics are tabulated and output
- *   to a comma-separated value (csv) file
+ * - each second, the data reception statistics are tabulated in memory
+ *   and written to a comma-separated value (csv) file at the end of the
+ *   run, or every --flushSamples seconds for long runs
  * - some tracing and flow monitor configuration that used to work is
  *   left commented inline in the program
  */
 
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <vector>
 #include "ns3/core-module.h"
 #include "ns3/network-module.h"
 #include "ns3/internet-module.h"
@@ -96,10 +99,22 @@ private:
   Ptr<Socket> SetupPacketReceive (Ipv4Address addr, Ptr<Node> node);
   void ReceivePacket (Ptr<Socket> socket);
   void CheckThroughput ();
+  void WriteSamples ();
+
+  /// Reception statistics of one second
+  struct ThroughputSample
+  {
+    double time;              //!< Simulation second
+    double kbs;               //!< Receive rate in kb/s
+    uint32_t packetsReceived; //!< Packets received during the second
+  };
 
   uint32_t port;
   uint32_t bytesTotal;
   uint32_t packetsReceived;
+  std::vector<ThroughputSample> m_samples; //!< Samples not yet written
+  uint32_t m_flushSamples;                 //!< Samples held before they are written
+  bool m_verbose;                          //!< Print every received packet
 
   std::string m_CSVfileName;
   int m_nSinks;
@@ -113,6 +128,8 @@ RoutingExperiment::RoutingExperiment ()
   : port (9),
     bytesTotal (0),
     packetsReceived (0),
+    m_flushSamples (4096),
+    m_verbose (false),
     m_CSVfileName ("manet-routing.output.csv"),
     m_traceMobility (false),
     m_protocol (2) // AODV
@@ -147,29 +164,52 @@ RoutingExperiment::ReceivePacket (Ptr<Socket> socket)
     {
       bytesTotal += packet->GetSize ();
       packetsReceived += 1;
-      NS_LOG_UNCOND (PrintReceivedPacket (socket, packet, senderAddress));
+      if (m_verbose)
+        {
+          NS_LOG_UNCOND (PrintReceivedPacket (socket, packet, senderAddress));
+        }
     }
 }
 
 void
 RoutingExperiment::CheckThroughput ()
 {
-  double kbs = (bytesTotal * 8.0) / 1000;
+  ThroughputSample sample;
+  sample.time = (Simulator::Now ()).GetSeconds ();
+  sample.kbs = (bytesTotal * 8.0) / 1000;
+  sample.packetsReceived = packetsReceived;
+  m_samples.push_back (sample);
   bytesTotal = 0;
+  packetsReceived = 0;
+  if (m_samples.size () >= m_flushSamples)
+    {
+      WriteSamples ();
+    }
+  Simulator::Schedule (Seconds (1.0), &RoutingExperiment::CheckThroughput, this);
+}
 
+void
+RoutingExperiment::WriteSamples ()
+{
+  if (m_samples.empty ())
+    {
+      return;
+    }
+  // Format every row first so the file is opened and written once
+  std::ostringstream rows;
+  for (std::vector<ThroughputSample>::const_iterator i = m_samples.begin (); i != m_samples.end (); ++i)
+    {
+      rows << i->time << ","
+           << i->kbs << ","
+           << i->packetsReceived << ","
+           << m_nSinks << ","
+           << m_protocolName << ","
+           << m_txp << "\n";
+    }
   std::ofstream out (m_CSVfileName.c_str (), std::ios::app);
-
-  out << (Simulator::Now ()).GetSeconds () << ","
-      << kbs << ","
-      << packetsReceived << ","
-      << m_nSinks << ","
-      << m_protocolName << ","
-      << m_txp << ""
-      << std::endl;
-
+  out << rows.str ();
   out.close ();
-  packetsReceived = 0;
-  Simulator::Schedule (Seconds (1.0), &RoutingExperiment::CheckThroughput, this);
+  m_samples.clear ();
 }
 
 Ptr<Socket>
@@ -191,6 +231,8 @@ RoutingExperiment::CommandSetup (int argc, char **argv)
   cmd.AddValue ("CSVfileName", "The name of the CSV output file name", m_CSVfileName);
   cmd.AddValue ("traceMobility", "Enable mobility tracing", m_traceMobility);
   cmd.AddValue ("protocol", "1=OLSR;2=AODV;3=DSDV;4=DSR", m_protocol);
+  cmd.AddValue ("verbose", "Print every received packet", m_verbose);
+  cmd.AddValue ("flushSamples", "Throughput samples held in memory before they are written", m_flushSamples);
   cmd.Parse (argc, argv);
   return m_CSVfileName;
 }
@@ -394,6 +436,7 @@ RoutingExperiment::Run (int nSinks, double txp, std::string CSVfileName)
 
   //flowmon->SerializeToXmlFile ((tr_name + ".flowmon").c_str(), false, false);
 
+  WriteSamples ();
   Simulator::Destroy ();
 }
 
@@ -8,7 +8,7 @@
 #include "ns3/wifi-module.h"
 #include "ns3/flow-monitor-module.h"
 #include "ns3/rtt-estimator.h"
-#include "myapp.h"
+#include "wormhole-scenario.h"
 
 NS_LOG_COMPONENT_DEFINE("Wormhole");
 
@@ -25,29 +25,32 @@ void wormhole(int param_count, char *param_list[])
 #pragma GCC diagnostic ignored "-Wunused-variable"
 
     bool enableFlowMonitor = false;
-    int nWifis = 5;
-    uint32_t port;
-    uint32_t bytesTotal;
-    uint32_t packetsReceived;
-
-    std::string m_CSVfileName;
-    int m_nSinks;
-    std::string m_protocolName;
-    double m_txp;
-    bool m_traceMobility;
-    uint32_t m_protocol;
+    bool attack = true;
+    uint32_t nWifis = 5;
+    uint32_t nPairs = 1;
+    uint32_t nFlows = 1;
+    std::string placement("fixed");
+    std::string pairs("1-2");
+    std::string flows("0-3");
 
     double TotalTime = 200.0;
     std::string rate("2048bps");
     std::string phyMode("DsssRate11Mbps");
-    std::string tr_name("manet-routing-compare");
     int nodeSpeed = 20; // in m/s
     int nodePause = 0;  // in s
-    m_protocolName = "protocol";
 
     CommandLine cmd;
     cmd.AddValue("EnableMonitor", "Enable Flow Monitor", enableFlowMonitor);
     cmd.AddValue("phyMode", "Wifi Phy mode", phyMode);
+    cmd.AddValue("nNodes", "Number of nodes", nWifis);
+    cmd.AddValue("nPairs", "Number of wormhole pairs, for random and farthest placement", nPairs);
+    cmd.AddValue("placement", "Wormhole placement: fixed, random or farthest", placement);
+    cmd.AddValue("pairs", "Wormhole pairs for fixed placement, as a-b,c-d node indices", pairs);
+    cmd.AddValue("flows", "Traffic matrix as source-sink node indices, e.g. 0-3,4-0; empty draws nFlows random flows", flows);
+    cmd.AddValue("nFlows", "Number of random flows when flows is empty", nFlows);
+    cmd.AddValue("nodeSpeed", "Maximum node speed in m/s", nodeSpeed);
+    cmd.AddValue("nodePause", "Node pause time in s", nodePause);
+    cmd.AddValue("attack", "Run the wormhole attack; false leaves the pairs honest", attack);
     cmd.Parse(param_count, param_list);
 
     Config::SetDefault("ns3::OnOffApplication::PacketSize", StringValue("64"));
@@ -56,137 +59,38 @@ void wormhole(int param_count, char *param_list[])
     // Set Non-unicastMode rate to unicast mode
     Config::SetDefault("ns3::WifiRemoteStationManager::NonUnicastMode", StringValue(phyMode));
 
-    // Create Nodes
-    NodeContainer cdevices;
-    NodeContainer malicious;
-    NodeContainer not_malicious;
-
-    cdevices.Create(nWifis);
-
-    not_malicious.Add(cdevices.Get(0));
-    not_malicious.Add(cdevices.Get(3));
-    not_malicious.Add(cdevices.Get(4));
-
-    malicious.Add(cdevices.Get(1));
-    malicious.Add(cdevices.Get(2));
-
-    // Setup wifi
-    WifiHelper wifi;
-    wifi.SetStandard(WIFI_STANDARD_80211b);
-
-    YansWifiPhyHelper wifiPhy;
-    wifiPhy.SetErrorRateModel("ns3::NistErrorRateModel");
-    wifiPhy.SetPcapDataLinkType(YansWifiPhyHelper::DLT_IEEE802_11);
-
-    YansWifiChannelHelper wifiChannel;
-    wifiChannel.SetPropagationDelay("ns3::ConstantSpeedPropagationDelayModel");
-
-    wifiChannel.AddPropagationLoss("ns3::TwoRayGroundPropagationLossModel", "SystemLoss", DoubleValue(1), "HeightAboveZ", DoubleValue(1.5));
-
-    // For range near 250m
-    wifiPhy.Set("TxPowerStart", DoubleValue(33));
-    wifiPhy.Set("TxPowerEnd", DoubleValue(33));
-    wifiPhy.SetChannel(wifiChannel.Create());
-
-    // Add a mac helper
-    WifiMacHelper wifiMac;
-    wifiMac.SetType("ns3::AdhocWifiMac");
-
-    wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
-                                 "DataMode", StringValue(phyMode),
-                                 "ControlMode", StringValue(phyMode));
-
-    NetDeviceContainer devices, mal_devices;
-    devices = wifi.Install(wifiPhy, wifiMac, cdevices);
-    mal_devices = wifi.Install(wifiPhy, wifiMac, malicious);
-
-    /** added by me **/
-
-    MobilityHelper mobilityAdhoc;
-    int64_t streamIndex = 0; // used to get consistent mobility across scenarios
-
-    ObjectFactory pos;
-    pos.SetTypeId("ns3::RandomRectanglePositionAllocator");
-    pos.Set("X", StringValue("ns3::UniformRandomVariable[Min=0.0|Max=300.0]"));
-    pos.Set("Y", StringValue("ns3::UniformRandomVariable[Min=0.0|Max=1500.0]"));
-
-    Ptr<PositionAllocator> taPositionAlloc = pos.Create()->GetObject<PositionAllocator>();
-    streamIndex += taPositionAlloc->AssignStreams(streamIndex);
-
-    std::stringstream ssSpeed;
-    ssSpeed << "ns3::UniformRandomVariable[Min=0.0|Max=" << nodeSpeed << "]";
-    std::stringstream ssPause;
-    ssPause << "ns3::ConstantRandomVariable[Constant=" << nodePause << "]";
-    mobilityAdhoc.SetMobilityModel("ns3::RandomWaypointMobilityModel",
-                                   "Speed", StringValue(ssSpeed.str()),
-                                   "Pause", StringValue(ssPause.str()),
-                                   "PositionAllocator", PointerValue(taPositionAlloc));
-    mobilityAdhoc.SetPositionAllocator(taPositionAlloc);
-    mobilityAdhoc.Install(cdevices);
-    mobilityAdhoc.Install(malicious);
-    mobilityAdhoc.Install(not_malicious);
-    streamIndex += mobilityAdhoc.AssignStreams(cdevices, streamIndex);
-    streamIndex += mobilityAdhoc.AssignStreams(malicious, streamIndex);
-    streamIndex += mobilityAdhoc.AssignStreams(not_malicious, streamIndex);
-    NS_UNUSED(streamIndex); // From this point, streamIndex is unused
-
-    //  Enable AODV
-    AodvHelper aodv;
-    AodvHelper malicious_aodv;
-
-    // Set up internet stack
-    InternetStackHelper internet;
-    internet.SetRoutingHelper(aodv);
-    internet.Install(not_malicious);
-
-    malicious_aodv.Set("EnableWrmAttack", BooleanValue(true)); // putting *false* instead of *true* would disable the malicious behavior of the node
-
-    malicious_aodv.Set("FirstEndWifiWormTunnel", Ipv4AddressValue("10.0.1.1"));
-    malicious_aodv.Set("SecondEndWifiWormTunnel", Ipv4AddressValue("10.0.1.2"));
-
-    internet.SetRoutingHelper(malicious_aodv);
-    internet.Install(malicious);
-
-    // Set up Addresses
-    Ipv4AddressHelper ipv4;
-    NS_LOG_INFO("Assign IP Addresses.");
-    ipv4.SetBase("10.0.1.0", "255.255.255.0");
-    Ipv4InterfaceContainer ifcont = ipv4.Assign(devices);
-
-    ipv4.SetBase("10.1.2.0", "255.255.255.0");
-    Ipv4InterfaceContainer mal_ifcont = ipv4.Assign(mal_devices);
-
-    NS_LOG_INFO("Create Applications.");
-
-    // TCP connection from N0 to N3
-    uint16_t sinkPort = 6;
-    Address sinkAddress(InetSocketAddress(ifcont.GetAddress(3), sinkPort)); // interface of n3
-    PacketSinkHelper packetSinkHelper("ns3::TcpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), sinkPort));
-    ApplicationContainer sinkApps = packetSinkHelper.Install(cdevices.Get(3)); // n3 as sink
-
-    sinkApps.Start(Seconds(0.));
-    sinkApps.Stop(Seconds(100.));
-
-    Ptr<Socket> ns3UdpSocket = Socket::CreateSocket(cdevices.Get(0), TcpSocketFactory::GetTypeId()); // source at n0
-
-    // Create TCP application at n0
-    Ptr<MyApp> app = CreateObject<MyApp>();
-    app->Setup(ns3UdpSocket, sinkAddress, 1040, 5, DataRate("250Kbps"));
-    cdevices.Get(0)->AddApplication(app);
-    app->SetStartTime(Seconds(40.));
-    app->SetStopTime(Seconds(100.));
+    WormholeScenario scenario;
+    WormholeScenario::Placement strategy;
+    NS_ABORT_MSG_UNLESS(WormholeScenario::ParsePlacement(placement, strategy), "unknown placement " << placement);
+    std::vector<WormholeScenario::Pair> pairList;
+    NS_ABORT_MSG_UNLESS(WormholeScenario::ParsePairs(pairs, pairList), "malformed pairs " << pairs);
+    std::vector<WormholeScenario::Flow> flowList;
+    NS_ABORT_MSG_UNLESS(WormholeScenario::ParseFlows(flows, flowList), "malformed flows " << flows);
+
+    scenario.SetNodes(nWifis);
+    scenario.SetPlacement(strategy, nPairs);
+    if (strategy == WormholeScenario::PLACEMENT_FIXED)
+    {
+        scenario.SetPairs(pairList);
+    }
+    scenario.SetFlows(flowList, nFlows);
+    scenario.SetMobility(nodeSpeed, nodePause, 300.0, 1500.0);
+    scenario.SetPhyMode(phyMode);
+    scenario.SetAttack(attack);
+
+    NS_LOG_INFO("Build scenario.");
+    scenario.Build();
+    for (std::vector<WormholeScenario::Pair>::const_iterator i = scenario.GetPairs().begin(); i != scenario.GetPairs().end(); ++i)
+    {
+        NS_LOG_INFO("Wormhole between n" << i->m_first << " and n" << i->m_second);
+    }
 
     AnimationInterface anim("wormhole_anim.xml"); // Mandatory
-    AnimationInterface::SetConstantPosition(cdevices.Get(0), 10, 40);
-    AnimationInterface::SetConstantPosition(cdevices.Get(1), 50, 25);
-    AnimationInterface::SetConstantPosition(cdevices.Get(2), 20, 37);
-    AnimationInterface::SetConstantPosition(cdevices.Get(3), 52, 100);
-    AnimationInterface::SetConstantPosition(cdevices.Get(4), 50, 75);
 
     anim.EnablePacketMetadata(true);
 
     Ptr<OutputStreamWrapper> routingStream = Create<OutputStreamWrapper>("wormhole.routes", std::ios::out);
-    aodv.PrintRoutingTableAllAt(Seconds(45), routingStream);
+    Ipv4RoutingHelper::PrintRoutingTableAllAt(Seconds(45), routingStream);
 
     // Trace Received Packets
     Config::ConnectWithoutContext("/NodeList/*/ApplicationList/*/$ns3::PacketSink/Rx", MakeCallback(&ReceivePacket));
@@ -210,7 +114,7 @@ void wormhole(int param_count, char *param_list[])
     for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator i = stats.begin(); i != stats.end(); ++i)
     {
         Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(i->first);
-        if ((t.sourceAddress == "10.0.1.1" && t.destinationAddress == "10.0.1.4"))
+        if (scenario.IsTrafficFlow(t.sourceAddress, t.destinationAddress))
         {
             o1 << "    Wormtunnel: Source: " << t.sourceAddress << " --> Destination " << t.destinationAddress << std::endl;
             o1 << "\t  Flow " << i->first << " (" << t.sourceAddress << " -> " << t.destinationAddress << ")\n";
@@ -0,0 +1,144 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation;
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+#include "rtt-anomaly-detector.h"
+#include "rtt-estimator.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/trace-source-accessor.h"
+#include <algorithm>
+
+namespace ns3
+{
+
+  NS_LOG_COMPONENT_DEFINE("RttAnomalyDetector");
+
+  NS_OBJECT_ENSURE_REGISTERED(RttAnomalyDetector);
+
+  TypeId
+  RttAnomalyDetector::GetTypeId(void)
+  {
+    static TypeId tid = TypeId("ns3::RttAnomalyDetector")
+                            .SetParent<Object>()
+                            .SetGroupName("Internet")
+                            .AddConstructor<RttAnomalyDetector>()
+                            .AddAttribute("Drift",
+                                          "Shift of delta, in RTT mean deviations, tolerated without accumulating evidence",
+                                          DoubleValue(0.5),
+                                          MakeDoubleAccessor(&RttAnomalyDetector::m_drift),
+                                          MakeDoubleChecker<double>(0))
+                            .AddAttribute("Threshold",
+                                          "Cumulative sum, in RTT mean deviations, at which an anomaly is raised",
+                                          DoubleValue(5.0),
+                                          MakeDoubleAccessor(&RttAnomalyDetector::m_threshold),
+                                          MakeDoubleChecker<double>(0))
+                            .AddAttribute("MinVariation",
+                                          "Floor applied to the RTT mean deviation before normalising delta; "
+                                          "a link whose RTT was constant would otherwise turn ordinary jitter into an anomaly",
+                                          TimeValue(MilliSeconds(1)),
+                                          MakeTimeAccessor(&RttAnomalyDetector::m_minVariation),
+                                          MakeTimeChecker())
+                            .AddTraceSource("Anomaly",
+                                            "A link RTT shifted away from its estimate",
+                                            MakeTraceSourceAccessor(&RttAnomalyDetector::m_anomalyTrace),
+                                            "ns3::RttAnomalyDetector::AnomalyTracedCallback");
+    return tid;
+  }
+
+  RttAnomalyDetector::RttAnomalyDetector()
+  {
+    NS_LOG_FUNCTION(this);
+  }
+
+  RttAnomalyDetector::~RttAnomalyDetector()
+  {
+    NS_LOG_FUNCTION(this);
+  }
+
+  bool
+  RttAnomalyDetector::Update(uint32_t link, Ptr<const RttEstimator> rtt)
+  {
+    return Update(link, rtt->CurrentDelta(), rtt->GetVariation());
+  }
+
+  bool
+  RttAnomalyDetector::Update(uint32_t link, Time delta, Time rttvar)
+  {
+    NS_LOG_FUNCTION(this << link << delta << rttvar);
+    if (link >= m_links.size())
+    {
+      LinkState idle = {0, 0, Time(-1)};
+      m_links.resize(link + 1, idle);
+    }
+    LinkState &s = m_links[link];
+
+    Time scale = s.rttvar.IsStrictlyNegative() ? rttvar : s.rttvar;
+    s.rttvar = rttvar;
+    double z = static_cast<double>(delta.GetInteger()) /
+               static_cast<double>(std::max(scale, m_minVariation).GetInteger());
+    s.high = std::max(0.0, s.high + z - m_drift);
+    s.low = std::max(0.0, s.low - z - m_drift);
+
+    bool raised = false;
+    if (s.high > m_threshold)
+    {
+      NS_LOG_DEBUG("Link " << link << " RTT rose, sum " << s.high);
+      s.high = 0;
+      m_anomalyTrace(link, HIGH, delta, rttvar);
+      raised = true;
+    }
+    if (s.low > m_threshold)
+    {
+      NS_LOG_DEBUG("Link " << link << " RTT dropped, sum " << s.low);
+      s.low = 0;
+      m_anomalyTrace(link, LOW, delta, rttvar);
+      raised = true;
+    }
+    return raised;
+  }
+
+  void
+  RttAnomalyDetector::Reset(uint32_t link)
+  {
+    NS_LOG_FUNCTION(this << link);
+    if (link < m_links.size())
+    {
+      m_links[link].high = 0;
+      m_links[link].low = 0;
+      m_links[link].rttvar = Time(-1);
+    }
+  }
+
+  void
+  RttAnomalyDetector::Reset(void)
+  {
+    NS_LOG_FUNCTION(this);
+    m_links.clear();
+  }
+
+  double
+  RttAnomalyDetector::GetHighSum(uint32_t link) const
+  {
+    return link < m_links.size() ? m_links[link].high : 0;
+  }
+
+  double
+  RttAnomalyDetector::GetLowSum(uint32_t link) const
+  {
+    return link < m_links.size() ? m_links[link].low : 0;
+  }
+
+} // namespace ns3
@@ -0,0 +1,144 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation;
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+#ifndef RTT_ANOMALY_DETECTOR_H
+#define RTT_ANOMALY_DETECTOR_H
+
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+#include "ns3/traced-callback.h"
+#include <vector>
+
+namespace ns3 {
+
+class RttEstimator;
+
+/**
+ * \ingroup tcp
+ *
+ * \brief Streaming change detector over RTT estimator deltas
+ *
+ * Runs a two-sided CUSUM test per link on the normalised innovation
+ * z = delta / rttvar, where delta is the sample minus the estimate it was
+ * compared against (RttEstimator::CurrentDelta) and rttvar the mean
+ * deviation (RttEstimator::GetVariation) that held alongside that
+ * estimate, i.e. the one passed in the previous update of the link;
+ * normalising by the variation that already absorbed the sample would
+ * hide the very step being looked for:
+ *
+ *   S+ <- max (0, S+ + z - k),   S- <- max (0, S- - z - k)
+ *
+ * rttvar is floored at MinVariation, 1 ms by default: after a run of equal
+ * RTTs it decays to nothing, and the first ordinary jitter would otherwise
+ * be thousands of deviations away.
+ *
+ * When either sum exceeds h the "Anomaly" trace source fires with the
+ * direction of the shift and that sum restarts from zero.  A sustained
+ * rise of the RTT per hop (a relayed tunnel) trips S+, a sustained drop
+ * below what the hop count implies (an out-of-band tunnel) trips S-.
+ *
+ * State is three words per link, so the detector keeps up with the
+ * estimator without storing samples.
+ */
+class RttAnomalyDetector : public Object
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /// Direction of a detected shift
+  enum Direction
+  {
+    LOW,  //!< RTT dropped below its estimate
+    HIGH  //!< RTT rose above its estimate
+  };
+
+  RttAnomalyDetector ();
+  virtual ~RttAnomalyDetector ();
+
+  /**
+   * \brief Feed the last sample of an estimator into a link's test.
+   * \param link the link index; links are created on first use
+   * \param rtt the estimator that just took a measurement
+   * \return true if an anomaly was raised
+   */
+  bool Update (uint32_t link, Ptr<const RttEstimator> rtt);
+
+  /**
+   * \brief Feed one innovation into a link's test.
+   * \param link the link index; links are created on first use
+   * \param delta sample minus the estimate it was compared against
+   * \param rttvar RTT mean deviation after the sample was taken
+   * \return true if an anomaly was raised
+   */
+  bool Update (uint32_t link, Time delta, Time rttvar);
+
+  /**
+   * \brief Restart the test of a link.
+   * \param link the link index
+   */
+  void Reset (uint32_t link);
+
+  /**
+   * \brief Restart the tests of all links.
+   */
+  void Reset (void);
+
+  /**
+   * \param link the link index
+   * \return the upward cumulative sum of the link
+   */
+  double GetHighSum (uint32_t link) const;
+
+  /**
+   * \param link the link index
+   * \return the downward cumulative sum of the link
+   */
+  double GetLowSum (uint32_t link) const;
+
+  /**
+   * TracedCallback signature for anomaly events.
+   *
+   * \param [in] link the link index
+   * \param [in] direction the Direction of the shift
+   * \param [in] delta the delta that raised the anomaly
+   * \param [in] rttvar the RTT mean deviation at that time
+   */
+  typedef void (* AnomalyTracedCallback)(uint32_t link, int direction, Time delta, Time rttvar);
+
+private:
+  /// Per-link CUSUM state
+  struct LinkState
+  {
+    double high; //!< Upward cumulative sum
+    double low;  //!< Downward cumulative sum
+    Time rttvar; //!< Mean deviation passed in the previous update, negative before the first
+  };
+
+  std::vector<LinkState> m_links; //!< Indexed by link
+  double m_drift;                 //!< Allowed drift k, in mean deviations
+  double m_threshold;             //!< Decision threshold h, in mean deviations
+  Time m_minVariation;            //!< Floor applied to rttvar before normalising
+  /// Fired on each detected shift
+  TracedCallback<uint32_t, int, Time, Time> m_anomalyTrace;
+};
+
+} // namespace ns3
+
+#endif /* RTT_ANOMALY_DETECTOR_H */
@@ -0,0 +1,353 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation;
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+#include "rtt-estimator-bank.h"
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include <new>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RTT_BANK_X86 1
+#include <immintrin.h>
+#endif
+
+namespace ns3
+{
+
+  NS_LOG_COMPONENT_DEFINE("RttEstimatorBank");
+
+  /// Alignment of the per-flow arrays, one AVX2 register
+  static const std::size_t BANK_ALIGNMENT = 32;
+
+  /**
+   * Allocate an aligned array
+   * \param n number of elements
+   * \return the array
+   */
+  static int64_t *
+  AllocateLanes(uint32_t n)
+  {
+    std::size_t bytes = (n ? n : 1) * sizeof(int64_t);
+    return static_cast<int64_t *>(::operator new(bytes, std::align_val_t(BANK_ALIGNMENT)));
+  }
+
+  /**
+   * Free an array allocated with AllocateLanes
+   * \param p the array
+   */
+  static void
+  FreeLanes(int64_t *p)
+  {
+    ::operator delete(p, std::align_val_t(BANK_ALIGNMENT));
+  }
+
+  RttEstimatorBank::RttEstimatorBank(uint32_t nFlows, Time initialEstimate,
+                                     uint32_t rttShift, uint32_t variationShift)
+      : m_nFlows(nFlows),
+        m_initialEstimate(initialEstimate.GetInteger()),
+        m_rttShift(rttShift),
+        m_variationShift(variationShift),
+        m_kernel(SCALAR),
+        m_estimate(AllocateLanes(nFlows)),
+        m_variation(AllocateLanes(nFlows)),
+        m_nSamples(AllocateLanes(nFlows))
+  {
+    NS_LOG_FUNCTION(this << nFlows << initialEstimate << rttShift << variationShift);
+    NS_ASSERT_MSG(rttShift >= 1 && rttShift <= 5, "Alpha must be 1/2 .. 1/32");
+    NS_ASSERT_MSG(variationShift >= 1 && variationShift <= 5, "Beta must be 1/2 .. 1/32");
+    SetKernel(AUTO);
+    Reset();
+  }
+
+  RttEstimatorBank::~RttEstimatorBank()
+  {
+    NS_LOG_FUNCTION(this);
+    FreeLanes(m_estimate);
+    FreeLanes(m_variation);
+    FreeLanes(m_nSamples);
+  }
+
+  bool
+  RttEstimatorBank::IsKernelSupported(Kernel kernel)
+  {
+    switch (kernel)
+    {
+    case AUTO:
+    case SCALAR:
+      return true;
+#ifdef RTT_BANK_X86
+    case SSE2:
+      return __builtin_cpu_supports("sse2");
+    case AVX2:
+      return __builtin_cpu_supports("avx2");
+#endif
+    default:
+      return false;
+    }
+  }
+
+  void
+  RttEstimatorBank::SetKernel(Kernel kernel)
+  {
+    NS_LOG_FUNCTION(this << kernel);
+    if (kernel == AUTO)
+    {
+      kernel = IsKernelSupported(AVX2) ? AVX2 : IsKernelSupported(SSE2) ? SSE2 : SCALAR;
+    }
+    m_kernel = IsKernelSupported(kernel) ? kernel : SCALAR;
+  }
+
+  void
+  RttEstimatorBank::Reset()
+  {
+    NS_LOG_FUNCTION(this);
+    for (uint32_t i = 0; i < m_nFlows; ++i)
+    {
+      Reset(i);
+    }
+  }
+
+  void
+  RttEstimatorBank::Reset(uint32_t flow)
+  {
+    NS_ASSERT(flow < m_nFlows);
+    m_estimate[flow] = m_initialEstimate;
+    m_variation[flow] = 0;
+    m_nSamples[flow] = 0;
+  }
+
+  void
+  RttEstimatorBank::Measurement(const int64_t *samples)
+  {
+    NS_LOG_FUNCTION(this);
+    uint32_t done = 0;
+    if (m_kernel == AVX2)
+    {
+      done = UpdateAvx2(samples);
+    }
+    else if (m_kernel == SSE2)
+    {
+      done = UpdateSse2(samples);
+    }
+    UpdateScalar(samples, done, m_nFlows);
+  }
+
+  void
+  RttEstimatorBank::Measurement(uint32_t flow, Time m)
+  {
+    NS_ASSERT(flow < m_nFlows);
+    NS_ASSERT_MSG(!m.IsStrictlyNegative(), "Negative RTT sample");
+    UpdateLane(flow, m.GetInteger());
+  }
+
+  void
+  RttEstimatorBank::UpdateLane(uint32_t i, int64_t m)
+  {
+    if (m_nSamples[i] == 0)
+    {
+      // First sample, as in RttMeanDeviation::Measurement
+      m_estimate[i] = m;
+      m_variation[i] = m / 2;
+    }
+    else
+    {
+      // RttMeanDeviation::IntegerUpdate
+      int64_t delta = m - m_estimate[i];
+      m_estimate[i] = ((m_estimate[i] << m_rttShift) + delta) >> m_rttShift;
+      if (delta < 0)
+      {
+        delta = -delta;
+      }
+      delta -= m_variation[i];
+      m_variation[i] = ((m_variation[i] << m_variationShift) + delta) >> m_variationShift;
+    }
+    m_nSamples[i]++;
+  }
+
+  void
+  RttEstimatorBank::UpdateScalar(const int64_t *samples, uint32_t begin, uint32_t end)
+  {
+    for (uint32_t i = begin; i < end; ++i)
+    {
+      if (samples[i] >= 0)
+      {
+        UpdateLane(i, samples[i]);
+      }
+    }
+  }
+
+#ifdef RTT_BANK_X86
+  /**
+   * Sign mask of two int64 lanes (all ones where negative), SSE2 only
+   * \param x the lanes
+   * \return the mask
+   */
+  __attribute__((target("sse2"))) static inline __m128i
+  SignMask64Sse2(__m128i x)
+  {
+    return _mm_shuffle_epi32(_mm_srai_epi32(x, 31), _MM_SHUFFLE(3, 3, 1, 1));
+  }
+
+  __attribute__((target("sse2"))) uint32_t
+  RttEstimatorBank::UpdateSse2(const int64_t *samples)
+  {
+    const __m128i rttShift = _mm_cvtsi32_si128(m_rttShift);
+    const __m128i varShift = _mm_cvtsi32_si128(m_variationShift);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi64x(1);
+    uint32_t i = 0;
+    for (; i + 2 <= m_nFlows; i += 2)
+    {
+      __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+      __m128i est = _mm_load_si128(reinterpret_cast<const __m128i *>(m_estimate + i));
+      __m128i var = _mm_load_si128(reinterpret_cast<const __m128i *>(m_variation + i));
+      __m128i n = _mm_load_si128(reinterpret_cast<const __m128i *>(m_nSamples + i));
+
+      __m128i skip = SignMask64Sse2(m);
+      __m128i eq32 = _mm_cmpeq_epi32(n, zero);
+      __m128i first = _mm_and_si128(eq32, _mm_shuffle_epi32(eq32, _MM_SHUFFLE(2, 3, 0, 1)));
+
+      // Integer update; shifts of possibly negative values are arithmetic
+      __m128i delta = _mm_sub_epi64(m, est);
+      __m128i s = _mm_add_epi64(_mm_sll_epi64(est, rttShift), delta);
+      __m128i sign = SignMask64Sse2(s);
+      __m128i newEst = _mm_xor_si128(_mm_srl_epi64(_mm_xor_si128(s, sign), rttShift), sign);
+      sign = SignMask64Sse2(delta);
+      __m128i absDelta = _mm_sub_epi64(_mm_xor_si128(delta, sign), sign);
+      __m128i v = _mm_add_epi64(_mm_sll_epi64(var, varShift), _mm_sub_epi64(absDelta, var));
+      sign = SignMask64Sse2(v);
+      __m128i newVar = _mm_xor_si128(_mm_srl_epi64(_mm_xor_si128(v, sign), varShift), sign);
+
+      // First sample: estimate = m, variation = m / 2 (m is not negative here)
+      newEst = _mm_or_si128(_mm_and_si128(first, m), _mm_andnot_si128(first, newEst));
+      newVar = _mm_or_si128(_mm_and_si128(first, _mm_srli_epi64(m, 1)), _mm_andnot_si128(first, newVar));
+
+      est = _mm_or_si128(_mm_and_si128(skip, est), _mm_andnot_si128(skip, newEst));
+      var = _mm_or_si128(_mm_and_si128(skip, var), _mm_andnot_si128(skip, newVar));
+      n = _mm_add_epi64(n, _mm_andnot_si128(skip, one));
+
+      _mm_store_si128(reinterpret_cast<__m128i *>(m_estimate + i), est);
+      _mm_store_si128(reinterpret_cast<__m128i *>(m_variation + i), var);
+      _mm_store_si128(reinterpret_cast<__m128i *>(m_nSamples + i), n);
+    }
+    return i;
+  }
+
+  /**
+   * Arithmetic right shift of four int64 lanes, which AVX2 lacks
+   * \param x the lanes
+   * \param count the shift count
+   * \return the shifted lanes
+   */
+  __attribute__((target("avx2"))) static inline __m256i
+  Sra64Avx2(__m256i x, __m128i count)
+  {
+    __m256i sign = _mm256_cmpgt_epi64(_mm256_setzero_si256(), x);
+    return _mm256_xor_si256(_mm256_srl_epi64(_mm256_xor_si256(x, sign), count), sign);
+  }
+
+  __attribute__((target("avx2"))) uint32_t
+  RttEstimatorBank::UpdateAvx2(const int64_t *samples)
+  {
+    const __m128i rttShift = _mm_cvtsi32_si128(m_rttShift);
+    const __m128i varShift = _mm_cvtsi32_si128(m_variationShift);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi64x(1);
+    uint32_t i = 0;
+    for (; i + 4 <= m_nFlows; i += 4)
+    {
+      __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(samples + i));
+      __m256i est = _mm256_load_si256(reinterpret_cast<const __m256i *>(m_estimate + i));
+      __m256i var = _mm256_load_si256(reinterpret_cast<const __m256i *>(m_variation + i));
+      __m256i n = _mm256_load_si256(reinterpret_cast<const __m256i *>(m_nSamples + i));
+
+      __m256i skip = _mm256_cmpgt_epi64(zero, m);
+      __m256i first = _mm256_cmpeq_epi64(n, zero);
+
+      __m256i delta = _mm256_sub_epi64(m, est);
+      __m256i newEst = Sra64Avx2(_mm256_add_epi64(_mm256_sll_epi64(est, rttShift), delta), rttShift);
+      __m256i sign = _mm256_cmpgt_epi64(zero, delta);
+      __m256i absDelta = _mm256_sub_epi64(_mm256_xor_si256(delta, sign), sign);
+      __m256i newVar = Sra64Avx2(_mm256_add_epi64(_mm256_sll_epi64(var, varShift), _mm256_sub_epi64(absDelta, var)),
+                                 varShift);
+
+      newEst = _mm256_blendv_epi8(newEst, m, first);
+      newVar = _mm256_blendv_epi8(newVar, _mm256_srli_epi64(m, 1), first);
+
+      est = _mm256_blendv_epi8(newEst, est, skip);
+      var = _mm256_blendv_epi8(newVar, var, skip);
+      n = _mm256_add_epi64(n, _mm256_andnot_si256(skip, one));
+
+      _mm256_store_si256(reinterpret_cast<__m256i *>(m_estimate + i), est);
+      _mm256_store_si256(reinterpret_cast<__m256i *>(m_variation + i), var);
+      _mm256_store_si256(reinterpret_cast<__m256i *>(m_nSamples + i), n);
+    }
+    return i;
+  }
+#else
+  uint32_t
+  RttEstimatorBank::UpdateSse2(const int64_t *)
+  {
+    return 0;
+  }
+
+  uint32_t
+  RttEstimatorBank::UpdateAvx2(const int64_t *)
+  {
+    return 0;
+  }
+#endif /* RTT_BANK_X86 */
+
+  uint32_t
+  RttEstimatorBank::GetNFlows(void) const
+  {
+    return m_nFlows;
+  }
+
+  Time
+  RttEstimatorBank::GetEstimate(uint32_t flow) const
+  {
+    NS_ASSERT(flow < m_nFlows);
+    return Time::From(m_estimate[flow]);
+  }
+
+  Time
+  RttEstimatorBank::GetVariation(uint32_t flow) const
+  {
+    NS_ASSERT(flow < m_nFlows);
+    return Time::From(m_variation[flow]);
+  }
+
+  uint32_t
+  RttEstimatorBank::GetNSamples(uint32_t flow) const
+  {
+    NS_ASSERT(flow < m_nFlows);
+    return static_cast<uint32_t>(m_nSamples[flow]);
+  }
+
+  const int64_t *
+  RttEstimatorBank::GetEstimates(void) const
+  {
+    return m_estimate;
+  }
+
+  const int64_t *
+  RttEstimatorBank::GetVariations(void) const
+  {
+    return m_variation;
+  }
+
+} // namespace ns3
@@ -0,0 +1,173 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation;
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+#ifndef RTT_ESTIMATOR_BANK_H
+#define RTT_ESTIMATOR_BANK_H
+
+#include "ns3/nstime.h"
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup tcp
+ *
+ * \brief Mean-deviation RTT estimators for many flows, stored as arrays
+ *
+ * Keeps the smoothed RTT, the RTT variation and the sample count of N
+ * flows in 32-byte aligned structure-of-arrays storage, and updates all
+ * flows in one pass with the integer Jacobson/Karels recurrence of
+ * RttMeanDeviation.  On x86 the pass runs in an AVX2 or SSE2 kernel chosen
+ * at run time, with a scalar fallback elsewhere.  Every lane produces
+ * exactly the values a RttMeanDeviation with Alpha = 2^-rttShift and
+ * Beta = 2^-variationShift would produce for the same samples.
+ *
+ * Only reciprocal power of two gains (1/2 .. 1/32) are supported; use
+ * RttMeanDeviation for floating point gains.  Values are in Time integer
+ * units (see Time::GetInteger).
+ */
+class RttEstimatorBank
+{
+public:
+  /// Update kernel
+  enum Kernel
+  {
+    AUTO,   //!< Best kernel supported by the CPU
+    SCALAR, //!< Portable scalar loop
+    SSE2,   //!< Two lanes per instruction
+    AVX2    //!< Four lanes per instruction
+  };
+
+  /**
+   * \brief Constructor
+   * \param nFlows number of flows
+   * \param initialEstimate estimate of a flow without samples
+   * \param rttShift log base 2 (1/alpha), 1 to 5
+   * \param variationShift log base 2 (1/beta), 1 to 5
+   */
+  RttEstimatorBank (uint32_t nFlows, Time initialEstimate = Seconds (1.0),
+                    uint32_t rttShift = 3, uint32_t variationShift = 2);
+  ~RttEstimatorBank ();
+
+  /**
+   * \brief Update every flow with one sample.
+   *
+   * A negative sample leaves the flow untouched, so flows without a
+   * measurement in this round can be skipped without compacting the array.
+   *
+   * \param samples one RTT measure per flow, GetNFlows () entries
+   */
+  void Measurement (const int64_t *samples);
+
+  /**
+   * \brief Update a single flow.
+   * \param flow the flow index
+   * \param m the RTT measure
+   */
+  void Measurement (uint32_t flow, Time m);
+
+  /**
+   * \brief Resets every flow to its initial state.
+   */
+  void Reset ();
+
+  /**
+   * \brief Resets one flow to its initial state.
+   * \param flow the flow index
+   */
+  void Reset (uint32_t flow);
+
+  /**
+   * \brief Select the update kernel.
+   * \param kernel the kernel; falls back to SCALAR if not supported
+   */
+  void SetKernel (Kernel kernel);
+
+  /**
+   * \brief Check whether a kernel can run on this CPU.
+   * \param kernel the kernel
+   * \return true if supported
+   */
+  static bool IsKernelSupported (Kernel kernel);
+
+  /// \return the number of flows
+  uint32_t GetNFlows (void) const;
+  /**
+   * \param flow the flow index
+   * \return the RTT estimate of the flow
+   */
+  Time GetEstimate (uint32_t flow) const;
+  /**
+   * \param flow the flow index
+   * \return the RTT variation of the flow
+   */
+  Time GetVariation (uint32_t flow) const;
+  /**
+   * \param flow the flow index
+   * \return the number of samples used by the flow
+   */
+  uint32_t GetNSamples (uint32_t flow) const;
+
+  /// \return the estimate array, GetNFlows () entries
+  const int64_t *GetEstimates (void) const;
+  /// \return the variation array, GetNFlows () entries
+  const int64_t *GetVariations (void) const;
+
+private:
+  /// Not copyable
+  RttEstimatorBank (const RttEstimatorBank &);
+  /// Not assignable
+  RttEstimatorBank &operator= (const RttEstimatorBank &);
+
+  /**
+   * \brief Update one flow with a sample
+   * \param i the flow index
+   * \param m the RTT measure, not negative
+   */
+  void UpdateLane (uint32_t i, int64_t m);
+  /**
+   * \brief Scalar update of flows [begin, end)
+   * \param samples the samples
+   * \param begin first flow
+   * \param end one past the last flow
+   */
+  void UpdateScalar (const int64_t *samples, uint32_t begin, uint32_t end);
+  /**
+   * \brief SSE2 update
+   * \param samples the samples
+   * \return number of flows updated, the rest is left to UpdateScalar
+   */
+  uint32_t UpdateSse2 (const int64_t *samples);
+  /**
+   * \brief AVX2 update
+   * \param samples the samples
+   * \return number of flows updated, the rest is left to UpdateScalar
+   */
+  uint32_t UpdateAvx2 (const int64_t *samples);
+
+  uint32_t m_nFlows;          //!< Number of flows
+  int64_t  m_initialEstimate; //!< Estimate of a flow without samples
+  uint32_t m_rttShift;        //!< log2 (1/alpha)
+  uint32_t m_variationShift;  //!< log2 (1/beta)
+  Kernel   m_kernel;          //!< Selected kernel
+  int64_t *m_estimate;        //!< Per-flow estimate, 32-byte aligned
+  int64_t *m_variation;       //!< Per-flow variation, 32-byte aligned
+  int64_t *m_nSamples;        //!< Per-flow sample count, 32-byte aligned
+};
+
+} // namespace ns3
+
+#endif /* RTT_ESTIMATOR_BANK_H */
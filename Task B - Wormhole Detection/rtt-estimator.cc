@@ -31,6 +31,8 @@
 #include "rtt-estimator.h"
 #include "ns3/double.h"
 #include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/trace-source-accessor.h"
 
 namespace ns3
 {
@@ -52,7 +54,11 @@ namespace ns3
                                           "Initial RTT estimate",
                                           TimeValue(Seconds(1.0)),
                                           MakeTimeAccessor(&RttEstimator::m_initialEstimatedRtt),
-                                          MakeTimeChecker());
+                                          MakeTimeChecker())
+                            .AddTraceSource("RttSample",
+                                            "RTT sample together with the delta and the updated estimate and variation",
+                                            MakeTraceSourceAccessor(&RttEstimator::m_rttSampleTrace),
+                                            "ns3::RttEstimator::RttSampleTracedCallback");
     return tid;
   }
 
@@ -88,7 +94,9 @@ namespace ns3
         m_initialEstimatedRtt(c.m_initialEstimatedRtt),
         m_estimatedRtt(c.m_estimatedRtt),
         m_estimatedVariation(c.m_estimatedVariation),
-        m_nSamples(c.m_nSamples)
+        m_nSamples(c.m_nSamples),
+        m_SampledRTT(c.m_SampledRTT),
+        m_CurrentDelta(c.m_CurrentDelta)
   {
     NS_LOG_FUNCTION(this);
   }
@@ -111,6 +119,26 @@ namespace ns3
     m_estimatedRtt = m_initialEstimatedRtt;
     m_estimatedVariation = Time(0);
     m_nSamples = 0;
+    m_SampledRTT = Time(0);
+    m_CurrentDelta = Time(0);
+  }
+
+  void
+  RttEstimator::MeasureBatch(const int64_t *samples, size_t n, int64_t *deltasOut, int64_t *estimatesOut)
+  {
+    NS_LOG_FUNCTION(this << n);
+    for (size_t i = 0; i < n; ++i)
+    {
+      Measurement(Time::From(samples[i]));
+      if (deltasOut)
+      {
+        deltasOut[i] = m_CurrentDelta.GetInteger();
+      }
+      if (estimatesOut)
+      {
+        estimatesOut[i] = m_estimatedRtt.GetInteger();
+      }
+    }
   }
 
   uint32_t
@@ -135,27 +163,62 @@ namespace ns3
                             .AddAttribute("Alpha",
                                           "Gain used in estimating the RTT, must be 0 <= alpha <= 1",
                                           DoubleValue(0.125),
-                                          MakeDoubleAccessor(&RttMeanDeviation::m_alpha),
+                                          MakeDoubleAccessor(&RttMeanDeviation::SetAlpha,
+                                                             &RttMeanDeviation::GetAlpha),
                                           MakeDoubleChecker<double>(0, 1))
                             .AddAttribute("Beta",
                                           "Gain used in estimating the RTT variation, must be 0 <= beta <= 1",
                                           DoubleValue(0.25),
-                                          MakeDoubleAccessor(&RttMeanDeviation::m_beta),
+                                          MakeDoubleAccessor(&RttMeanDeviation::SetBeta,
+                                                             &RttMeanDeviation::GetBeta),
                                           MakeDoubleChecker<double>(0, 1));
     return tid;
   }
 
   RttMeanDeviation::RttMeanDeviation()
+      : m_alpha(0.125),
+        m_beta(0.25),
+        m_rttShift(3),
+        m_variationShift(2)
   {
     NS_LOG_FUNCTION(this);
   }
 
   RttMeanDeviation::RttMeanDeviation(const RttMeanDeviation &c)
-      : RttEstimator(c), m_alpha(c.m_alpha), m_beta(c.m_beta)
+      : RttEstimator(c), m_alpha(c.m_alpha), m_beta(c.m_beta),
+        m_rttShift(c.m_rttShift), m_variationShift(c.m_variationShift)
   {
     NS_LOG_FUNCTION(this);
   }
 
+  void
+  RttMeanDeviation::SetAlpha(double alpha)
+  {
+    NS_LOG_FUNCTION(this << alpha);
+    m_alpha = alpha;
+    m_rttShift = CheckForReciprocalPowerOfTwo(alpha);
+  }
+
+  double
+  RttMeanDeviation::GetAlpha(void) const
+  {
+    return m_alpha;
+  }
+
+  void
+  RttMeanDeviation::SetBeta(double beta)
+  {
+    NS_LOG_FUNCTION(this << beta);
+    m_beta = beta;
+    m_variationShift = CheckForReciprocalPowerOfTwo(beta);
+  }
+
+  double
+  RttMeanDeviation::GetBeta(void) const
+  {
+    return m_beta;
+  }
+
   TypeId
   RttMeanDeviation::GetInstanceTypeId(void) const
   {
@@ -204,6 +267,8 @@ namespace ns3
 
     // SRTT <- (1 - alpha) * SRTT + alpha *  R'
     Time err(m - m_estimatedRtt);
+    m_SampledRTT = m;
+    m_CurrentDelta = err;
     double gErr = err.ToDouble(Time::S) * m_alpha;
     m_estimatedRtt += Time::FromDouble(gErr, Time::S);
 
@@ -229,19 +294,6 @@ namespace ns3
 
     m_CurrentDelta = Time::From(delta);
 
-    /**** Delta = Measured RTT - m_estimatedRtt???******************
-    outfile.open("measured_n_delta.txt", std::ios_base::app);
-    //NS_LOG_INFO (m_estimatedRtt);
-    outfile << est_counter++;
-    outfile << " ";
-    outfile << meas;
-    outfile << " ";
-    outfile << delta;
-    outfile << "\n";
-    outfile.close();*/
-
-    /************************************************************************/
-
     int64_t srtt = (m_estimatedRtt.GetInteger() << rttShift) + delta;
     m_estimatedRtt = Time::From(srtt >> rttShift);
     if (delta < 0)
@@ -264,12 +316,11 @@ namespace ns3
       // If both alpha and beta are reciprocal powers of two, updating can
       // be done with integer arithmetic according to Jacobson/Karels paper.
       // If not, since class Time only supports integer multiplication,
-      // must convert Time to floating point and back again
-      uint32_t rttShift = CheckForReciprocalPowerOfTwo(m_alpha);
-      uint32_t variationShift = CheckForReciprocalPowerOfTwo(m_beta);
-      if (rttShift && variationShift)
+      // must convert Time to floating point and back again.
+      // The shifts are cached by SetAlpha and SetBeta.
+      if (m_rttShift && m_variationShift)
       {
-        IntegerUpdate(m, rttShift, variationShift);
+        IntegerUpdate(m, m_rttShift, m_variationShift);
       }
       else
       {
@@ -278,11 +329,86 @@ namespace ns3
     }
     else
     {                               // First sample
+      m_SampledRTT = m;
+      m_CurrentDelta = Time(0);     // Nothing to compare against yet
       m_estimatedRtt = m;           // Set estimate to current
       m_estimatedVariation = m / 2; // And variation to current / 2
       NS_LOG_DEBUG("(first sample) m_estimatedVariation += " << m);
     }
     m_nSamples++;
+    m_rttSampleTrace(Simulator::Now(), m_SampledRTT, m_CurrentDelta, m_estimatedRtt, m_estimatedVariation);
+  }
+
+  void
+  RttMeanDeviation::MeasureBatch(const int64_t *samples, size_t n, int64_t *deltasOut, int64_t *estimatesOut)
+  {
+    NS_LOG_FUNCTION(this << n);
+    if (n == 0)
+    {
+      return;
+    }
+    if (!(m_rttShift && m_variationShift) || !m_rttSampleTrace.IsEmpty())
+    {
+      // Floating point gains need Time arithmetic, and connected RttSample
+      // sinks expect one call per sample; only skip the dispatch
+      for (size_t i = 0; i < n; ++i)
+      {
+        RttMeanDeviation::Measurement(Time::From(samples[i]));
+        if (deltasOut)
+        {
+          deltasOut[i] = m_CurrentDelta.GetInteger();
+        }
+        if (estimatesOut)
+        {
+          estimatesOut[i] = m_estimatedRtt.GetInteger();
+        }
+      }
+      return;
+    }
+
+    const uint32_t rttShift = m_rttShift;
+    const uint32_t variationShift = m_variationShift;
+    int64_t est = m_estimatedRtt.GetInteger();
+    int64_t var = m_estimatedVariation.GetInteger();
+    int64_t delta = m_CurrentDelta.GetInteger();
+    size_t i = 0;
+    if (m_nSamples == 0)
+    {
+      // First sample, as in Measurement ()
+      est = samples[0];
+      var = samples[0] / 2;
+      delta = 0;
+      if (deltasOut)
+      {
+        deltasOut[0] = 0;
+      }
+      if (estimatesOut)
+      {
+        estimatesOut[0] = est;
+      }
+      i = 1;
+    }
+    // Same arithmetic as IntegerUpdate (), kept on locals
+    for (; i < n; ++i)
+    {
+      delta = samples[i] - est;
+      est = ((est << rttShift) + delta) >> rttShift;
+      int64_t err = (delta < 0 ? -delta : delta) - var;
+      var = ((var << variationShift) + err) >> variationShift;
+      if (deltasOut)
+      {
+        deltasOut[i] = delta;
+      }
+      if (estimatesOut)
+      {
+        estimatesOut[i] = est;
+      }
+    }
+    m_estimatedRtt = Time::From(est);
+    m_estimatedVariation = Time::From(var);
+    m_SampledRTT = Time::From(samples[n - 1]);
+    m_CurrentDelta = Time::From(delta);
+    m_nSamples += n;
   }
 
   Ptr<RttEstimator>
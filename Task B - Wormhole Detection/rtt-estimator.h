@@ -27,6 +27,7 @@
 
 #include "ns3/nstime.h"
 #include "ns3/object.h"
+#include "ns3/traced-callback.h"
 
 namespace ns3 {
 
@@ -65,6 +66,25 @@ public:
    */
   virtual void  Measurement (Time t) = 0;
 
+  /**
+   * \brief Add a contiguous run of measurements to the estimator.
+   *
+   * Equivalent to calling Measurement () once per sample, but writes the
+   * per-sample delta (sample minus the estimate it was compared against,
+   * zero for the first sample) and the updated estimate to the output
+   * arrays.  Samples and outputs are in Time integer units (see
+   * Time::GetInteger).  Either output array may be null.
+   *
+   * The base implementation loops over Measurement (); subclasses may
+   * provide a tighter loop.
+   *
+   * \param samples the RTT measures
+   * \param n number of samples
+   * \param deltasOut per-sample delta, n entries, or null
+   * \param estimatesOut per-sample estimate, n entries, or null
+   */
+  virtual void MeasureBatch (const int64_t *samples, size_t n, int64_t *deltasOut, int64_t *estimatesOut);
+
   /**
    * \brief Copy object (including current internal state)
    * \returns a copy of itself
@@ -110,6 +130,17 @@ public:
 
   Time CurrentDelta(void) const;
 
+  /**
+   * TracedCallback signature for RTT samples.
+   *
+   * \param [in] now the simulation time of the sample
+   * \param [in] sample the RTT measure
+   * \param [in] delta the sample minus the estimate it was compared against
+   * \param [in] estimate the updated RTT estimate
+   * \param [in] variation the updated RTT estimate variation
+   */
+  typedef void (* RttSampleTracedCallback)(Time now, Time sample, Time delta, Time estimate, Time variation);
+
 private:
   Time m_initialEstimatedRtt; //!< Initial RTT estimation
 
@@ -119,8 +150,11 @@ protected:
   uint32_t     m_nSamples;                //!< Number of samples
 
   /**Added ****************************************************/
-  Time m_SampledRTT;   //!< Current estimate variation
-  Time m_CurrentDelta; //!< Current estimate variation
+  Time m_SampledRTT;   //!< Last RTT sample
+  Time m_CurrentDelta; //!< Last sample minus the estimate it was compared against
+
+  /// Fired after every measurement with the updated state
+  TracedCallback<Time, Time, Time, Time, Time> m_rttSampleTrace;
 };
 
 /**
@@ -160,6 +194,21 @@ public:
    */
   void Measurement (Time measure);
 
+  /**
+   * \brief Add a contiguous run of measurements to the estimator.
+   *
+   * When both gains are reciprocal powers of two and nothing is connected
+   * to the RttSample trace source, the Jacobson/Karels recurrence runs
+   * over the span on local integers, without virtual dispatch or Time
+   * construction per sample.
+   *
+   * \param samples the RTT measures
+   * \param n number of samples
+   * \param deltasOut per-sample delta, n entries, or null
+   * \param estimatesOut per-sample estimate, n entries, or null
+   */
+  void MeasureBatch (const int64_t *samples, size_t n, int64_t *deltasOut, int64_t *estimatesOut);
+
   Ptr<RttEstimator> Copy () const;
 
   /**
@@ -167,6 +216,27 @@ public:
    */
   void Reset ();
 
+  /**
+   * \brief Set the gain used in estimating the RTT.
+   * \param alpha the gain, 0 <= alpha <= 1
+   */
+  void SetAlpha (double alpha);
+  /**
+   * \brief Get the gain used in estimating the RTT.
+   * \return the gain
+   */
+  double GetAlpha (void) const;
+  /**
+   * \brief Set the gain used in estimating the RTT variation.
+   * \param beta the gain, 0 <= beta <= 1
+   */
+  void SetBeta (double beta);
+  /**
+   * \brief Get the gain used in estimating the RTT variation.
+   * \return the gain
+   */
+  double GetBeta (void) const;
+
 private:
   /** 
    * Utility function to check for possible conversion
@@ -199,6 +269,8 @@ private:
   void FloatingPointUpdate (Time m);
   double       m_alpha;       //!< Filter gain for average
   double       m_beta;        //!< Filter gain for variation
+  uint32_t     m_rttShift;    //!< log2 (1/alpha), derived by SetAlpha rather than per sample; zero if alpha is not a supported reciprocal power of two
+  uint32_t     m_variationShift; //!< log2 (1/beta), derived by SetBeta rather than per sample; zero if beta is not a supported reciprocal power of two
 
 };
 
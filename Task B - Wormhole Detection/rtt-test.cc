@@ -17,11 +17,17 @@
 
 #include "ns3/test.h"
 #include "ns3/rtt-estimator.h"
+#include "ns3/rtt-estimator-bank.h"
+#include "ns3/rtt-anomaly-detector.h"
+#include "ns3/rtt-trace-writer.h"
 #include "ns3/attribute.h"
 #include "ns3/nstime.h"
 #include "ns3/config.h"
 #include "ns3/log.h"
 #include "ns3/double.h"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
 
 using namespace ns3;
 
@@ -172,6 +178,401 @@ RttEstimatorTestCase::DoTeardown (void)
 {
 }
 
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief RTT estimator batch measurement Test
+ *
+ * Feeds the same samples one by one and through MeasureBatch () and
+ * checks that the delta and estimate streams and the final state match.
+ */
+class RttEstimatorBatchTestCase : public TestCase
+{
+public:
+  RttEstimatorBatchTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \brief Compare per-sample and batch measurement.
+   * \param alpha The gain used in estimating the RTT.
+   * \param beta The gain used in estimating the RTT variation.
+   */
+  void CheckBatch (double alpha, double beta);
+};
+
+RttEstimatorBatchTestCase::RttEstimatorBatchTestCase ()
+  : TestCase ("Rtt Estimator batch measurement Test")
+{
+}
+
+void
+RttEstimatorBatchTestCase::CheckBatch (double alpha, double beta)
+{
+  Ptr<RttMeanDeviation> single = CreateObject<RttMeanDeviation> ();
+  single->SetAttribute ("Alpha", DoubleValue (alpha));
+  single->SetAttribute ("Beta", DoubleValue (beta));
+  Ptr<RttEstimator> batch = single->Copy ();
+
+  const size_t n = 64;
+  int64_t samples[n];
+  int64_t deltas[n];
+  int64_t estimates[n];
+  for (size_t i = 0; i < n; i++)
+    {
+      // Jittered RTTs with a step half way, as seen through a tunnel
+      samples[i] = MilliSeconds (20 + (i * 7) % 13 + (i >= n / 2 ? 40 : 0)).GetInteger ();
+    }
+
+  // Split the span to check that state carries across calls
+  batch->MeasureBatch (samples, 1, deltas, estimates);
+  batch->MeasureBatch (samples + 1, n - 1, deltas + 1, estimates + 1);
+  for (size_t i = 0; i < n; i++)
+    {
+      single->Measurement (Time::From (samples[i]));
+      NS_TEST_EXPECT_MSG_EQ (deltas[i], single->CurrentDelta ().GetInteger (), "Delta " << i << " not correct");
+      NS_TEST_EXPECT_MSG_EQ (estimates[i], single->GetEstimate ().GetInteger (), "Estimate " << i << " not correct");
+    }
+  NS_TEST_EXPECT_MSG_EQ (deltas[0], 0, "First sample delta should be zero");
+  NS_TEST_EXPECT_MSG_EQ (batch->GetEstimate (), single->GetEstimate (), "Final estimate not correct");
+  NS_TEST_EXPECT_MSG_EQ (batch->GetVariation (), single->GetVariation (), "Final variation not correct");
+  NS_TEST_EXPECT_MSG_EQ (batch->GetNSamples (), n, "Number of samples not correct");
+  NS_TEST_EXPECT_MSG_EQ (batch->MeasuredRttSample (), Time::From (samples[n - 1]), "Last sample not correct");
+  NS_TEST_EXPECT_MSG_EQ (batch->CurrentDelta (), single->CurrentDelta (), "Last delta not correct");
+
+  // Null output arrays only update the state
+  batch->MeasureBatch (samples, n, 0, 0);
+  single->MeasureBatch (samples, n, deltas, 0);
+  NS_TEST_EXPECT_MSG_EQ (batch->GetEstimate (), single->GetEstimate (), "Estimate without outputs not correct");
+  NS_TEST_EXPECT_MSG_EQ (batch->GetVariation (), single->GetVariation (), "Variation without outputs not correct");
+}
+
+void
+RttEstimatorBatchTestCase::DoRun (void)
+{
+  // Integer path
+  CheckBatch (0.125, 0.25);
+  CheckBatch (0.5, 0.03125);
+  // Floating point path
+  CheckBatch (0.1, 0.1);
+}
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief RTT estimator bank Test
+ *
+ * Every lane of a RttEstimatorBank must match a RttMeanDeviation fed
+ * the same samples, whichever update kernel runs.
+ */
+class RttEstimatorBankTestCase : public TestCase
+{
+public:
+  RttEstimatorBankTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \brief Compare a bank against one RttMeanDeviation per lane.
+   * \param kernel The update kernel.
+   */
+  void CheckKernel (RttEstimatorBank::Kernel kernel);
+};
+
+RttEstimatorBankTestCase::RttEstimatorBankTestCase ()
+  : TestCase ("Rtt Estimator bank Test")
+{
+}
+
+void
+RttEstimatorBankTestCase::CheckKernel (RttEstimatorBank::Kernel kernel)
+{
+  // Odd flow count so the vector kernels leave a scalar tail
+  const uint32_t nFlows = 11;
+  RttEstimatorBank bank (nFlows, Seconds (1));
+  bank.SetKernel (kernel);
+
+  std::vector<Ptr<RttMeanDeviation> > ref;
+  for (uint32_t i = 0; i < nFlows; i++)
+    {
+      Ptr<RttMeanDeviation> rtt = CreateObject<RttMeanDeviation> ();
+      rtt->SetAttribute ("InitialEstimation", TimeValue (Seconds (1)));
+      rtt->SetAttribute ("Alpha", DoubleValue (0.125));
+      rtt->SetAttribute ("Beta", DoubleValue (0.25));
+      rtt->Reset ();
+      ref.push_back (rtt);
+    }
+
+  // Same sequence as RttEstimatorTestCase on every lane
+  const int64_t rfc[] = { Seconds (1).GetInteger (), MilliSeconds (1200).GetInteger (), MilliSeconds (900).GetInteger () };
+  int64_t samples[nFlows];
+  for (uint32_t round = 0; round < 3; round++)
+    {
+      for (uint32_t i = 0; i < nFlows; i++)
+        {
+          samples[i] = rfc[round];
+        }
+      bank.Measurement (samples);
+    }
+  for (uint32_t i = 0; i < nFlows; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (bank.GetEstimate (i), Time (MicroSeconds (1009375)), "Estimate not correct on lane " << i);
+      NS_TEST_EXPECT_MSG_EQ (bank.GetVariation (i), Time (MilliSeconds (350)), "Variation not correct on lane " << i);
+    }
+
+  // Per-lane jitter, steps and skipped lanes
+  bank.Reset ();
+  for (uint32_t round = 0; round < 200; round++)
+    {
+      for (uint32_t i = 0; i < nFlows; i++)
+        {
+          if ((round + i) % 5 == 0)
+            {
+              samples[i] = -1;
+              continue;
+            }
+          samples[i] = MicroSeconds (1000 * (i + 1) + (round * 7919 + i * 104729) % 3000 + (round > 100 && i % 3 == 0 ? 40000 : 0)).GetInteger ();
+          ref[i]->Measurement (Time::From (samples[i]));
+        }
+      bank.Measurement (samples);
+      for (uint32_t i = 0; i < nFlows; i++)
+        {
+          NS_TEST_EXPECT_MSG_EQ (bank.GetEstimate (i), ref[i]->GetEstimate (), "Estimate not correct on lane " << i);
+          NS_TEST_EXPECT_MSG_EQ (bank.GetVariation (i), ref[i]->GetVariation (), "Variation not correct on lane " << i);
+          NS_TEST_EXPECT_MSG_EQ (bank.GetNSamples (i), ref[i]->GetNSamples (), "Sample count not correct on lane " << i);
+        }
+    }
+}
+
+void
+RttEstimatorBankTestCase::DoRun (void)
+{
+  CheckKernel (RttEstimatorBank::SCALAR);
+  if (RttEstimatorBank::IsKernelSupported (RttEstimatorBank::SSE2))
+    {
+      CheckKernel (RttEstimatorBank::SSE2);
+    }
+  if (RttEstimatorBank::IsKernelSupported (RttEstimatorBank::AVX2))
+    {
+      CheckKernel (RttEstimatorBank::AVX2);
+    }
+}
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief RTT anomaly detector Test
+ *
+ * A jittery but stable RTT must not raise anything, even after a run of
+ * equal RTTs; a step up must raise a HIGH anomaly at once and a step down
+ * a LOW one.
+ */
+class RttAnomalyDetectorTestCase : public TestCase
+{
+public:
+  RttAnomalyDetectorTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \brief Anomaly trace sink.
+   * \param link The link index.
+   * \param direction The direction of the shift.
+   * \param delta The delta that raised the anomaly.
+   * \param rttvar The RTT mean deviation.
+   */
+  void Anomaly (uint32_t link, int direction, Time delta, Time rttvar);
+
+  uint32_t m_high; //!< HIGH anomalies seen
+  uint32_t m_low;  //!< LOW anomalies seen
+  uint32_t m_link; //!< Link of the last anomaly
+};
+
+RttAnomalyDetectorTestCase::RttAnomalyDetectorTestCase ()
+  : TestCase ("Rtt anomaly detector Test"),
+    m_high (0),
+    m_low (0),
+    m_link (0)
+{
+}
+
+void
+RttAnomalyDetectorTestCase::Anomaly (uint32_t link, int direction, Time delta, Time rttvar)
+{
+  m_link = link;
+  if (direction == RttAnomalyDetector::HIGH)
+    {
+      m_high++;
+    }
+  else
+    {
+      m_low++;
+    }
+}
+
+void
+RttAnomalyDetectorTestCase::DoRun (void)
+{
+  Ptr<RttMeanDeviation> rtt = CreateObject<RttMeanDeviation> ();
+  rtt->SetAttribute ("Alpha", DoubleValue (0.125));
+  rtt->SetAttribute ("Beta", DoubleValue (0.25));
+  Ptr<RttAnomalyDetector> detector = CreateObject<RttAnomalyDetector> ();
+  detector->TraceConnectWithoutContext ("Anomaly", MakeCallback (&RttAnomalyDetectorTestCase::Anomaly, this));
+
+  const uint32_t link = 3;
+  for (uint32_t i = 0; i < 100; i++)
+    {
+      rtt->Measurement (MilliSeconds (i % 2 ? 21 : 19));
+      detector->Update (link, rtt);
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_high + m_low, 0, "Stable RTT raised an anomaly");
+
+  rtt->Measurement (MilliSeconds (40));
+  NS_TEST_EXPECT_MSG_EQ (detector->Update (link, rtt), true, "Step up not detected");
+  NS_TEST_EXPECT_MSG_EQ (m_high, 1, "Step up not reported as HIGH");
+  NS_TEST_EXPECT_MSG_EQ (m_link, link, "Wrong link reported");
+
+  detector->Reset (link);
+  rtt->Reset ();
+  m_high = 0;
+  for (uint32_t i = 0; i < 100; i++)
+    {
+      rtt->Measurement (MilliSeconds (i % 2 ? 21 : 19));
+      detector->Update (link, rtt);
+    }
+  for (uint32_t i = 0; i < 5; i++)
+    {
+      rtt->Measurement (MilliSeconds (5));
+      detector->Update (link, rtt);
+    }
+  NS_TEST_EXPECT_MSG_GT (m_low, 0, "Step down not reported as LOW");
+  NS_TEST_EXPECT_MSG_EQ (m_high, 0, "Step down reported as HIGH");
+  NS_TEST_EXPECT_MSG_EQ (detector->GetHighSum (0), 0, "Unused link has state");
+
+  // A constant RTT drives the mean deviation to zero; the floor keeps the
+  // jitter that follows from looking like a shift
+  detector->Reset (link);
+  rtt->Reset ();
+  m_high = 0;
+  m_low = 0;
+  for (uint32_t i = 0; i < 50; i++)
+    {
+      rtt->Measurement (MilliSeconds (20));
+      detector->Update (link, rtt);
+    }
+  for (uint32_t i = 0; i < 20; i++)
+    {
+      rtt->Measurement (MilliSeconds (i % 2 ? 19 : 21));
+      detector->Update (link, rtt);
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_high + m_low, 0, "Jitter after a constant RTT raised an anomaly");
+
+  // A previous mean deviation of zero is a real one: the step is measured
+  // against the MinVariation floor, not the deviation that absorbed it
+  NS_TEST_EXPECT_MSG_EQ (detector->Update (5, Seconds (0), Seconds (0)), false, "Constant RTT raised an anomaly");
+  NS_TEST_EXPECT_MSG_EQ (detector->Update (5, MilliSeconds (10), MilliSeconds (10)), true, "Step after a constant RTT not detected");
+  NS_TEST_EXPECT_MSG_EQ (m_high, 1, "Step after a constant RTT not reported as HIGH");
+}
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief RTT trace writer Test
+ *
+ * Records written through the RttSample trace source must read back
+ * unchanged, both for an unbounded file and for a ring that wrapped, and
+ * a closed writer must no longer be called by the estimator.
+ */
+class RttTraceWriterTestCase : public TestCase
+{
+public:
+  RttTraceWriterTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \brief Write samples through the trace source and read them back.
+   * \param bufferRecords Records per writer buffer.
+   * \param ringRecords Ring capacity, zero if unbounded.
+   */
+  void CheckFile (uint32_t bufferRecords, uint64_t ringRecords);
+};
+
+RttTraceWriterTestCase::RttTraceWriterTestCase ()
+  : TestCase ("Rtt trace writer Test")
+{
+}
+
+void
+RttTraceWriterTestCase::CheckFile (uint32_t bufferRecords, uint64_t ringRecords)
+{
+  const uint32_t n = 10;
+  const uint32_t flow = 7;
+  std::string filename = CreateTempDirFilename ("rtt-trace.bin");
+  Ptr<RttMeanDeviation> rtt = CreateObject<RttMeanDeviation> ();
+  rtt->SetAttribute ("Alpha", DoubleValue (0.125));
+  rtt->SetAttribute ("Beta", DoubleValue (0.25));
+
+  std::vector<RttTraceWriter::Record> expected;
+  Ptr<RttTraceWriter> writer = Create<RttTraceWriter> (filename, bufferRecords, ringRecords);
+  writer->Connect (rtt, flow);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      rtt->Measurement (MilliSeconds (20 + i));
+      RttTraceWriter::Record r;
+      r.sample = rtt->MeasuredRttSample ().GetInteger ();
+      r.delta = rtt->CurrentDelta ().GetInteger ();
+      r.estimate = rtt->GetEstimate ().GetInteger ();
+      r.variation = rtt->GetVariation ().GetInteger ();
+      expected.push_back (r);
+    }
+  NS_TEST_EXPECT_MSG_EQ (writer->GetRecordCount (), n, "Record count not correct");
+  writer->Close ();
+  // Closing disconnects the writer, so the estimator may outlive it
+  rtt->Measurement (MilliSeconds (20));
+  NS_TEST_EXPECT_MSG_EQ (writer->GetRecordCount (), n, "Sample recorded after Close");
+  writer = 0;
+  rtt->Measurement (MilliSeconds (20));
+
+  std::FILE *f = std::fopen (filename.c_str (), "rb");
+  NS_TEST_ASSERT_MSG_NE (f, 0, "Trace file not created");
+  RttTraceWriter::FileHeader header;
+  NS_TEST_ASSERT_MSG_EQ (std::fread (&header, sizeof (header), 1, f), 1, "Header missing");
+  NS_TEST_EXPECT_MSG_EQ (std::string (header.magic, 4), "RTTS", "Wrong magic");
+  NS_TEST_EXPECT_MSG_EQ (header.recordSize, sizeof (RttTraceWriter::Record), "Wrong record size");
+  NS_TEST_EXPECT_MSG_EQ (header.records, n, "Wrong record count in header");
+  uint64_t stored = ringRecords ? std::min<uint64_t> (ringRecords, n) : n;
+  for (uint64_t slot = 0; slot < stored; slot++)
+    {
+      RttTraceWriter::Record r;
+      NS_TEST_ASSERT_MSG_EQ (std::fread (&r, sizeof (r), 1, f), 1, "Record " << slot << " missing");
+      // In a ring, slot s keeps the last record i with i % ringRecords == s
+      uint64_t i = ringRecords ? ((n - 1 - slot) / ringRecords) * ringRecords + slot : slot;
+      NS_TEST_EXPECT_MSG_EQ (r.flow, flow, "Wrong flow in record " << i);
+      NS_TEST_EXPECT_MSG_EQ (r.sample, expected[i].sample, "Wrong sample in record " << i);
+      NS_TEST_EXPECT_MSG_EQ (r.delta, expected[i].delta, "Wrong delta in record " << i);
+      NS_TEST_EXPECT_MSG_EQ (r.estimate, expected[i].estimate, "Wrong estimate in record " << i);
+      NS_TEST_EXPECT_MSG_EQ (r.variation, expected[i].variation, "Wrong variation in record " << i);
+    }
+  NS_TEST_EXPECT_MSG_EQ (std::fgetc (f), EOF, "Trailing data in trace file");
+  std::fclose (f);
+}
+
+void
+RttTraceWriterTestCase::DoRun (void)
+{
+  CheckFile (3, 0);
+  CheckFile (3, 4);
+}
+
 /**
  * \ingroup internet-test
  * \ingroup tests
@@ -185,6 +586,10 @@ public:
     : TestSuite ("rtt-estimator", UNIT)
   {
     AddTestCase (new RttEstimatorTestCase, TestCase::QUICK);
+    AddTestCase (new RttEstimatorBatchTestCase, TestCase::QUICK);
+    AddTestCase (new RttEstimatorBankTestCase, TestCase::QUICK);
+    AddTestCase (new RttAnomalyDetectorTestCase, TestCase::QUICK);
+    AddTestCase (new RttTraceWriterTestCase, TestCase::QUICK);
   }
 
 };
@@ -0,0 +1,220 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation;
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+#include "rtt-trace-writer.h"
+#include "rtt-estimator.h"
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+#include "ns3/callback.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+namespace ns3
+{
+
+  NS_LOG_COMPONENT_DEFINE("RttTraceWriter");
+
+  RttTraceWriter::RttTraceWriter(std::string filename, uint32_t bufferRecords, uint64_t ringRecords)
+      : m_filename(filename),
+        m_file(std::fopen(filename.c_str(), "w+b")),
+        m_bufferRecords(bufferRecords ? bufferRecords : 1),
+        m_ringRecords(ringRecords),
+        m_records(0),
+        m_pendingFirst(0),
+        m_busy(false),
+        m_stop(false),
+        m_failed(false)
+  {
+    NS_LOG_FUNCTION(this << filename << bufferRecords << ringRecords);
+    if (m_file == 0)
+    {
+      NS_FATAL_ERROR("Cannot open RTT trace file " << filename);
+    }
+    // Buffered I/O is already done here; skip the stdio copy
+    std::setvbuf(m_file, 0, _IONBF, 0);
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "RTTS", 4);
+    header.version = 1;
+    header.recordSize = sizeof(Record);
+    header.resolution = Time::GetResolution();
+    header.ringRecords = m_ringRecords;
+    if (std::fwrite(&header, sizeof(header), 1, m_file) != 1)
+    {
+      NS_FATAL_ERROR("Cannot write RTT trace header to " << filename);
+    }
+
+    m_active.reserve(m_bufferRecords);
+    m_pending.reserve(m_bufferRecords);
+    m_thread = std::thread(&RttTraceWriter::Run, this);
+  }
+
+  RttTraceWriter::~RttTraceWriter()
+  {
+    NS_LOG_FUNCTION(this);
+    Close();
+  }
+
+  void
+  RttTraceWriter::Connect(Ptr<RttEstimator> rtt, uint32_t flow)
+  {
+    NS_LOG_FUNCTION(this << rtt << flow);
+    Callback<void, Time, Time, Time, Time, Time> sink = MakeBoundCallback(&RttTraceWriter::Sink, this, flow);
+    rtt->TraceConnectWithoutContext("RttSample", sink);
+    // Kept so that Close() can disconnect; the estimator may outlive the writer
+    m_connections.push_back(Connection(rtt, sink));
+  }
+
+  void
+  RttTraceWriter::Sink(RttTraceWriter *writer, uint32_t flow, Time now, Time sample, Time delta, Time estimate, Time variation)
+  {
+    writer->Write(flow, now, sample, delta, estimate, variation);
+  }
+
+  void
+  RttTraceWriter::Write(uint32_t flow, Time now, Time sample, Time delta, Time estimate, Time variation)
+  {
+    if (m_file == 0)
+    {
+      return;
+    }
+    Record r;
+    r.time = now.GetInteger();
+    r.flow = flow;
+    r.reserved = 0;
+    r.sample = sample.GetInteger();
+    r.delta = delta.GetInteger();
+    r.estimate = estimate.GetInteger();
+    r.variation = variation.GetInteger();
+    m_active.push_back(r);
+    if (m_active.size() == m_bufferRecords)
+    {
+      Submit();
+    }
+  }
+
+  void
+  RttTraceWriter::Submit(void)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // Back-pressure: wait until the previous buffer is on disk
+    m_cv.wait(lock, [this] { return !m_busy; });
+    if (m_failed)
+    {
+      NS_FATAL_ERROR("Short write to RTT trace file " << m_filename);
+    }
+    m_pending.swap(m_active);
+    m_pendingFirst = m_records;
+    m_records += m_pending.size();
+    m_busy = true;
+    lock.unlock();
+    m_cv.notify_all();
+    m_active.clear();
+  }
+
+  void
+  RttTraceWriter::Run(void)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+      m_cv.wait(lock, [this] { return m_busy || m_stop; });
+      if (m_busy)
+      {
+        lock.unlock();
+        bool written = Flush(m_pending, m_pendingFirst);
+        lock.lock();
+        m_failed = m_failed || !written;
+        m_pending.clear();
+        m_busy = false;
+        m_cv.notify_all();
+      }
+      else if (m_stop)
+      {
+        return;
+      }
+    }
+  }
+
+  bool
+  RttTraceWriter::Flush(const std::vector<Record> &buffer, uint64_t first)
+  {
+    if (m_ringRecords == 0)
+    {
+      return std::fwrite(buffer.data(), sizeof(Record), buffer.size(), m_file) == buffer.size();
+    }
+    // Ring: write contiguous runs between wrap points
+    size_t done = 0;
+    while (done < buffer.size())
+    {
+      uint64_t slot = (first + done) % m_ringRecords;
+      size_t run = std::min<uint64_t>(buffer.size() - done, m_ringRecords - slot);
+      if (std::fseek(m_file, sizeof(FileHeader) + slot * sizeof(Record), SEEK_SET) != 0 ||
+          std::fwrite(buffer.data() + done, sizeof(Record), run, m_file) != run)
+      {
+        return false;
+      }
+      done += run;
+    }
+    return true;
+  }
+
+  void
+  RttTraceWriter::Close(void)
+  {
+    NS_LOG_FUNCTION(this);
+    if (m_file == 0)
+    {
+      return;
+    }
+    for (std::vector<Connection>::const_iterator i = m_connections.begin(); i != m_connections.end(); ++i)
+    {
+      i->first->TraceDisconnectWithoutContext("RttSample", i->second);
+    }
+    m_connections.clear();
+    if (!m_active.empty())
+    {
+      Submit();
+    }
+    bool failed;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait(lock, [this] { return !m_busy; });
+      m_stop = true;
+      failed = m_failed;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+
+    // Record count goes last so a truncated file is recognisable
+    failed = failed || std::fseek(m_file, offsetof(FileHeader, records), SEEK_SET) != 0 ||
+             std::fwrite(&m_records, sizeof(m_records), 1, m_file) != 1;
+    failed = std::fclose(m_file) != 0 || failed;
+    m_file = 0;
+    if (failed)
+    {
+      NS_FATAL_ERROR("Short write to RTT trace file " << m_filename);
+    }
+  }
+
+  uint64_t
+  RttTraceWriter::GetRecordCount(void) const
+  {
+    return m_records + m_active.size();
+  }
+
+} // namespace ns3
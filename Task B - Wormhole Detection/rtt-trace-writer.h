@@ -0,0 +1,167 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation;
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+#ifndef RTT_TRACE_WRITER_H
+#define RTT_TRACE_WRITER_H
+
+#include "ns3/callback.h"
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+
+class RttEstimator;
+
+/**
+ * \ingroup tcp
+ *
+ * \brief Binary sink for the RttEstimator "RttSample" trace source
+ *
+ * Records are appended to one of two in-memory buffers; when a buffer
+ * fills, it is handed to a background thread that writes it out while the
+ * simulation keeps filling the other one, so the simulation only pays a
+ * memory copy per sample.
+ *
+ * The file starts with a FileHeader followed by fixed-size Record
+ * entries in host byte order.  With a ring capacity the file holds at most
+ * that many records and older ones are overwritten; record i lives in slot
+ * i % ringRecords and FileHeader::records tells how many were written in
+ * total.  Time fields are in Time integer units at FileHeader::resolution.
+ *
+ * Close() disconnects the writer from every estimator it was connected
+ * to, and fails if the file could not be written in full.
+ */
+class RttTraceWriter : public SimpleRefCount<RttTraceWriter>
+{
+public:
+  /// File header
+  struct FileHeader
+  {
+    char     magic[4];      //!< "RTTS"
+    uint16_t version;       //!< Layout version, 1
+    uint16_t recordSize;    //!< sizeof (Record)
+    uint32_t resolution;    //!< Time::Unit of the time fields
+    uint32_t reserved;      //!< Zero
+    uint64_t ringRecords;   //!< Ring capacity in records, zero if unbounded
+    uint64_t records;       //!< Number of records written in total
+  };
+
+  /// One RTT sample
+  struct Record
+  {
+    int64_t  time;      //!< Simulation time of the sample
+    uint32_t flow;      //!< Flow identifier given at Connect
+    uint32_t reserved;  //!< Zero
+    int64_t  sample;    //!< RTT measure
+    int64_t  delta;     //!< Sample minus the estimate it was compared against
+    int64_t  estimate;  //!< Updated RTT estimate
+    int64_t  variation; //!< Updated RTT estimate variation
+  };
+
+  /**
+   * \brief Constructor; opens the file
+   * \param filename the output file
+   * \param bufferRecords records per buffer
+   * \param ringRecords ring capacity in records, zero for an unbounded file
+   */
+  RttTraceWriter (std::string filename, uint32_t bufferRecords = 65536, uint64_t ringRecords = 0);
+  /// Destructor; closes the file
+  ~RttTraceWriter ();
+
+  /**
+   * \brief Connect to the RttSample trace source of an estimator.
+   * \param rtt the estimator
+   * \param flow identifier stored in each record of this estimator
+   */
+  void Connect (Ptr<RttEstimator> rtt, uint32_t flow);
+
+  /**
+   * \brief Append one record.
+   * \param flow the flow identifier
+   * \param now the simulation time of the sample
+   * \param sample the RTT measure
+   * \param delta the sample minus the estimate it was compared against
+   * \param estimate the updated RTT estimate
+   * \param variation the updated RTT estimate variation
+   */
+  void Write (uint32_t flow, Time now, Time sample, Time delta, Time estimate, Time variation);
+
+  /**
+   * \brief Flush pending records, finalize the header and close the file.
+   *
+   * The writer is disconnected from its estimators and further writes are
+   * ignored.
+   */
+  void Close (void);
+
+  /// \return the number of records written so far
+  uint64_t GetRecordCount (void) const;
+
+private:
+  /**
+   * \brief Trace sink bound to a writer and a flow
+   * \param writer the writer
+   * \param flow the flow identifier
+   * \param now the simulation time of the sample
+   * \param sample the RTT measure
+   * \param delta the sample minus the estimate it was compared against
+   * \param estimate the updated RTT estimate
+   * \param variation the updated RTT estimate variation
+   */
+  static void Sink (RttTraceWriter *writer, uint32_t flow, Time now, Time sample, Time delta, Time estimate, Time variation);
+  /// Hand the active buffer to the background thread
+  void Submit (void);
+  /// Background thread body
+  void Run (void);
+  /**
+   * \brief Write a buffer to the file
+   * \param buffer the records
+   * \param first index of the first record in the whole trace
+   * \return true if the whole buffer was written
+   */
+  bool Flush (const std::vector<Record> &buffer, uint64_t first);
+
+  /// An estimator and the sink connected to its RttSample trace source
+  typedef std::pair<Ptr<RttEstimator>, CallbackBase> Connection;
+
+  std::string m_filename;         //!< Output file name
+  std::FILE *m_file;              //!< Output file
+  uint32_t m_bufferRecords;       //!< Records per buffer
+  uint64_t m_ringRecords;         //!< Ring capacity, zero if unbounded
+  uint64_t m_records;             //!< Records appended so far
+  std::vector<Record> m_active;   //!< Buffer being filled
+  std::vector<Record> m_pending;  //!< Buffer being written
+  uint64_t m_pendingFirst;        //!< Trace index of the first pending record
+  bool m_busy;                    //!< The background thread owns m_pending
+  bool m_stop;                    //!< Background thread must exit
+  bool m_failed;                  //!< A buffer could not be written in full
+  std::mutex m_mutex;             //!< Protects m_pending, m_busy, m_stop and m_failed
+  std::condition_variable m_cv;   //!< Signals hand-over in both directions
+  std::thread m_thread;           //!< Background writer
+  std::vector<Connection> m_connections; //!< Connected trace sources
+};
+
+} // namespace ns3
+
+#endif /* RTT_TRACE_WRITER_H */
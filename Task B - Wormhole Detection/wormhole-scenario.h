@@ -0,0 +1,504 @@
+#include "ns3/aodv-module.h"
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/wifi-module.h"
+#include "myapp.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * Builds an AODV wormhole scenario of N nodes with K wormhole pairs.
+ *
+ * Every node gets one wifi device and one mobility model. The ends of each
+ * wormhole pair are joined by their own point-to-point link, the tunnel, and
+ * get an AODV instance whose tunnel attributes name the addresses of that
+ * pair; EnableWrmAttack is set on these instances from SetAttack, so it does
+ * not follow the attribute default. Addresses follow a fixed plan so the
+ * attributes can be set before the stack is installed: node i is
+ * 10.0.1.1 + i on a /16 subnet so more than 254 nodes fit, and pair k has the
+ * /30 subnet 10.1.0.0 + 4k, so no tunnel end can reach another pair. Flows
+ * are TCP MyApp flows between honest nodes, taken from a traffic matrix or
+ * drawn at random.
+ */
+class WormholeScenario
+{
+public:
+    /// How the ends of the wormhole pairs are chosen
+    enum Placement
+    {
+        PLACEMENT_FIXED,    ///< pairs given with SetPairs
+        PLACEMENT_RANDOM,   ///< distinct nodes drawn at random
+        PLACEMENT_FARTHEST, ///< pairs of unused nodes farthest apart at start, greedily
+    };
+
+    /// Ends of one wormhole, as node indices
+    struct Pair
+    {
+        uint32_t m_first;
+        uint32_t m_second;
+    };
+
+    /// One entry of the traffic matrix, as node indices
+    struct Flow
+    {
+        uint32_t m_source;
+        uint32_t m_sink;
+    };
+
+    WormholeScenario();
+
+    void SetNodes(uint32_t nNodes) { m_nNodes = nNodes; }
+    void SetPlacement(Placement placement, uint32_t nPairs);
+    /// Pairs of PLACEMENT_FIXED; also sets the number of pairs
+    void SetPairs(const std::vector<Pair> &pairs);
+    /// Traffic matrix; when empty, nFlows flows are drawn between honest nodes
+    void SetFlows(const std::vector<Flow> &flows, uint32_t nFlows);
+    void SetMobility(double speed, double pause, double x, double y);
+    void SetPhyMode(const std::string &phyMode) { m_phyMode = phyMode; }
+    /// False installs the tunnel devices but leaves AODV honest on the pairs
+    void SetAttack(bool enable) { m_attack = enable; }
+
+    /// Create nodes, devices, stacks, addresses and applications
+    void Build();
+
+    NodeContainer GetNodes() const { return m_nodes; }
+    Ipv4InterfaceContainer GetInterfaces() const { return m_interfaces; }
+    Ipv4InterfaceContainer GetTunnelInterfaces() const { return m_tunnelInterfaces; }
+    const std::vector<Pair> &GetPairs() const { return m_pairs; }
+    const std::vector<Flow> &GetFlows() const { return m_flows; }
+    /// True if the addresses are the ends of a flow of the traffic matrix
+    bool IsTrafficFlow(Ipv4Address source, Ipv4Address sink) const;
+
+    /// Parse "a-b,c-d,..." into pairs; false on a malformed list
+    static bool ParsePairs(const std::string &text, std::vector<Pair> &pairs);
+    /// Parse "a-b,c-d,..." into source-sink flows; false on a malformed list
+    static bool ParseFlows(const std::string &text, std::vector<Flow> &flows);
+    /// Parse "random", "farthest" or "fixed"; false on anything else
+    static bool ParsePlacement(const std::string &text, Placement &placement);
+
+private:
+    void InstallMobility();
+    void ChoosePairs();
+    void ChooseFlows();
+    void InstallDevices();
+    void InstallStacks();
+    void InstallApplications();
+    bool IsMalicious(uint32_t node) const;
+    Ipv4Address WifiAddress(uint32_t node) const;
+    Ipv4Address TunnelAddress(uint32_t end) const;
+
+    uint32_t m_nNodes;
+    uint32_t m_nPairs;
+    uint32_t m_nFlows;
+    Placement m_placement;
+    bool m_attack;
+    double m_speed;
+    double m_pause;
+    double m_x;
+    double m_y;
+    std::string m_phyMode;
+    uint16_t m_port;
+    int64_t m_streamIndex;
+
+    std::vector<Pair> m_pairs;
+    std::vector<Flow> m_flows;
+    Ptr<UniformRandomVariable> m_random;
+
+    NodeContainer m_nodes;
+    NetDeviceContainer m_devices;
+    NetDeviceContainer m_tunnelDevices; ///< ends of the pairs, in pair order
+    Ipv4InterfaceContainer m_interfaces;
+    Ipv4InterfaceContainer m_tunnelInterfaces;
+};
+
+WormholeScenario::WormholeScenario() : m_nNodes(5),
+                                       m_nPairs(1),
+                                       m_nFlows(1),
+                                       m_placement(PLACEMENT_RANDOM),
+                                       m_attack(true),
+                                       m_speed(20),
+                                       m_pause(0),
+                                       m_x(300),
+                                       m_y(1500),
+                                       m_phyMode("DsssRate11Mbps"),
+                                       m_port(6),
+                                       m_streamIndex(0)
+{
+}
+
+void WormholeScenario::SetPlacement(Placement placement, uint32_t nPairs)
+{
+    m_placement = placement;
+    m_nPairs = nPairs;
+}
+
+void WormholeScenario::SetPairs(const std::vector<Pair> &pairs)
+{
+    m_pairs = pairs;
+    m_nPairs = pairs.size();
+}
+
+void WormholeScenario::SetFlows(const std::vector<Flow> &flows, uint32_t nFlows)
+{
+    m_flows = flows;
+    m_nFlows = flows.empty() ? nFlows : flows.size();
+}
+
+void WormholeScenario::SetMobility(double speed, double pause, double x, double y)
+{
+    m_speed = speed;
+    m_pause = pause;
+    m_x = x;
+    m_y = y;
+}
+
+void WormholeScenario::Build()
+{
+    NS_ABORT_MSG_IF(m_nNodes > 65000, "at most 65000 nodes fit the address plan");
+    NS_ABORT_MSG_IF(2 * m_nPairs > m_nNodes, "need two nodes per wormhole pair");
+
+    m_nodes.Create(m_nNodes);
+    InstallMobility();
+
+    m_random = CreateObject<UniformRandomVariable>();
+    m_streamIndex += m_random->AssignStreams(m_streamIndex);
+    ChoosePairs();
+    ChooseFlows();
+
+    InstallDevices();
+    InstallStacks();
+    InstallApplications();
+}
+
+void WormholeScenario::InstallMobility()
+{
+    ObjectFactory pos;
+    pos.SetTypeId("ns3::RandomRectanglePositionAllocator");
+    std::stringstream ssX;
+    ssX << "ns3::UniformRandomVariable[Min=0.0|Max=" << m_x << "]";
+    std::stringstream ssY;
+    ssY << "ns3::UniformRandomVariable[Min=0.0|Max=" << m_y << "]";
+    pos.Set("X", StringValue(ssX.str()));
+    pos.Set("Y", StringValue(ssY.str()));
+
+    Ptr<PositionAllocator> taPositionAlloc = pos.Create()->GetObject<PositionAllocator>();
+    m_streamIndex += taPositionAlloc->AssignStreams(m_streamIndex);
+
+    std::stringstream ssSpeed;
+    ssSpeed << "ns3::UniformRandomVariable[Min=0.0|Max=" << m_speed << "]";
+    std::stringstream ssPause;
+    ssPause << "ns3::ConstantRandomVariable[Constant=" << m_pause << "]";
+
+    MobilityHelper mobilityAdhoc;
+    mobilityAdhoc.SetMobilityModel("ns3::RandomWaypointMobilityModel",
+                                   "Speed", StringValue(ssSpeed.str()),
+                                   "Pause", StringValue(ssPause.str()),
+                                   "PositionAllocator", PointerValue(taPositionAlloc));
+    mobilityAdhoc.SetPositionAllocator(taPositionAlloc);
+    mobilityAdhoc.Install(m_nodes);
+    m_streamIndex += mobilityAdhoc.AssignStreams(m_nodes, m_streamIndex);
+}
+
+void WormholeScenario::ChoosePairs()
+{
+    if (m_placement == PLACEMENT_FIXED)
+    {
+        std::vector<bool> used(m_nNodes, false);
+        for (std::vector<Pair>::const_iterator i = m_pairs.begin(); i != m_pairs.end(); ++i)
+        {
+            NS_ABORT_MSG_IF(i->m_first >= m_nNodes || i->m_second >= m_nNodes,
+                            "wormhole pair " << i->m_first << "-" << i->m_second << " names a missing node");
+            NS_ABORT_MSG_IF(i->m_first == i->m_second || used[i->m_first] || used[i->m_second],
+                            "node used twice in the wormhole pairs");
+            used[i->m_first] = used[i->m_second] = true;
+        }
+        return;
+    }
+
+    m_pairs.clear();
+    if (m_placement == PLACEMENT_RANDOM)
+    {
+        std::vector<uint32_t> order(m_nNodes);
+        for (uint32_t i = 0; i < m_nNodes; ++i)
+        {
+            order[i] = i;
+        }
+        // Fisher-Yates on the scenario stream, so a run is reproducible
+        for (uint32_t i = m_nNodes - 1; i > 0; --i)
+        {
+            std::swap(order[i], order[m_random->GetInteger(0, i)]);
+        }
+        for (uint32_t k = 0; k < m_nPairs; ++k)
+        {
+            Pair pair = {order[2 * k], order[2 * k + 1]};
+            m_pairs.push_back(pair);
+        }
+        return;
+    }
+
+    std::vector<Vector> position(m_nNodes);
+    for (uint32_t i = 0; i < m_nNodes; ++i)
+    {
+        position[i] = m_nodes.Get(i)->GetObject<MobilityModel>()->GetPosition();
+    }
+    std::vector<bool> used(m_nNodes, false);
+    for (uint32_t k = 0; k < m_nPairs; ++k)
+    {
+        Pair best = {0, 0};
+        double bestDistance = -1;
+        for (uint32_t i = 0; i < m_nNodes; ++i)
+        {
+            for (uint32_t j = i + 1; j < m_nNodes && !used[i]; ++j)
+            {
+                double distance = CalculateDistance(position[i], position[j]);
+                if (!used[j] && distance > bestDistance)
+                {
+                    best.m_first = i;
+                    best.m_second = j;
+                    bestDistance = distance;
+                }
+            }
+        }
+        used[best.m_first] = used[best.m_second] = true;
+        m_pairs.push_back(best);
+    }
+}
+
+void WormholeScenario::ChooseFlows()
+{
+    for (std::vector<Flow>::const_iterator i = m_flows.begin(); i != m_flows.end(); ++i)
+    {
+        NS_ABORT_MSG_IF(i->m_source >= m_nNodes || i->m_sink >= m_nNodes || i->m_source == i->m_sink,
+                        "bad flow " << i->m_source << "-" << i->m_sink);
+    }
+    if (!m_flows.empty() || m_nFlows == 0)
+    {
+        return;
+    }
+
+    std::vector<uint32_t> honest;
+    for (uint32_t i = 0; i < m_nNodes; ++i)
+    {
+        if (!IsMalicious(i))
+        {
+            honest.push_back(i);
+        }
+    }
+    NS_ABORT_MSG_IF(honest.size() < 2, "random flows need two honest nodes");
+    for (uint32_t k = 0; k < m_nFlows; ++k)
+    {
+        uint32_t source = m_random->GetInteger(0, honest.size() - 1);
+        uint32_t sink = m_random->GetInteger(0, honest.size() - 2);
+        if (sink >= source)
+        {
+            ++sink;
+        }
+        Flow flow = {honest[source], honest[sink]};
+        m_flows.push_back(flow);
+    }
+}
+
+void WormholeScenario::InstallDevices()
+{
+    WifiHelper wifi;
+    wifi.SetStandard(WIFI_STANDARD_80211b);
+
+    YansWifiPhyHelper wifiPhy;
+    wifiPhy.SetErrorRateModel("ns3::NistErrorRateModel");
+    wifiPhy.SetPcapDataLinkType(YansWifiPhyHelper::DLT_IEEE802_11);
+
+    YansWifiChannelHelper wifiChannel;
+    wifiChannel.SetPropagationDelay("ns3::ConstantSpeedPropagationDelayModel");
+    wifiChannel.AddPropagationLoss("ns3::TwoRayGroundPropagationLossModel", "SystemLoss", DoubleValue(1), "HeightAboveZ", DoubleValue(1.5));
+
+    // For range near 250m
+    wifiPhy.Set("TxPowerStart", DoubleValue(33));
+    wifiPhy.Set("TxPowerEnd", DoubleValue(33));
+    wifiPhy.SetChannel(wifiChannel.Create());
+
+    WifiMacHelper wifiMac;
+    wifiMac.SetType("ns3::AdhocWifiMac");
+
+    wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
+                                 "DataMode", StringValue(m_phyMode),
+                                 "ControlMode", StringValue(m_phyMode));
+
+    m_devices = wifi.Install(wifiPhy, wifiMac, m_nodes);
+
+    // A link of its own per pair, out of band and out of reach of the other pairs
+    PointToPointHelper tunnel;
+    tunnel.SetDeviceAttribute("DataRate", StringValue("100Mbps"));
+    tunnel.SetChannelAttribute("Delay", StringValue("1ms"));
+    for (std::vector<Pair>::const_iterator i = m_pairs.begin(); i != m_pairs.end(); ++i)
+    {
+        m_tunnelDevices.Add(tunnel.Install(m_nodes.Get(i->m_first), m_nodes.Get(i->m_second)));
+    }
+}
+
+void WormholeScenario::InstallStacks()
+{
+    InternetStackHelper internet;
+
+    AodvHelper aodv;
+    NodeContainer honest;
+    for (uint32_t i = 0; i < m_nNodes; ++i)
+    {
+        if (!IsMalicious(i))
+        {
+            honest.Add(m_nodes.Get(i));
+        }
+    }
+    internet.SetRoutingHelper(aodv);
+    internet.Install(honest);
+
+    // One helper per pair, since the tunnel attributes differ between pairs
+    for (uint32_t k = 0; k < m_pairs.size(); ++k)
+    {
+        AodvHelper malicious_aodv;
+        malicious_aodv.Set("EnableWrmAttack", BooleanValue(m_attack));
+        malicious_aodv.Set("FirstEndOfWormTunnel", Ipv4AddressValue(TunnelAddress(2 * k)));
+        malicious_aodv.Set("SecondEndOfWormTunnel", Ipv4AddressValue(TunnelAddress(2 * k + 1)));
+        malicious_aodv.Set("FirstEndWifiWormTunnel", Ipv4AddressValue(WifiAddress(m_pairs[k].m_first)));
+        malicious_aodv.Set("SecondEndWifiWormTunnel", Ipv4AddressValue(WifiAddress(m_pairs[k].m_second)));
+
+        NodeContainer pair(m_nodes.Get(m_pairs[k].m_first), m_nodes.Get(m_pairs[k].m_second));
+        internet.SetRoutingHelper(malicious_aodv);
+        internet.Install(pair);
+    }
+
+    Ipv4AddressHelper ipv4;
+    ipv4.SetBase("10.0.0.0", "255.255.0.0", "0.0.1.1");
+    m_interfaces = ipv4.Assign(m_devices);
+    for (uint32_t k = 0; k < m_pairs.size(); ++k)
+    {
+        NetDeviceContainer ends(m_tunnelDevices.Get(2 * k));
+        ends.Add(m_tunnelDevices.Get(2 * k + 1));
+        ipv4.SetBase(Ipv4Address(TunnelAddress(2 * k).Get() - 1), "255.255.255.252");
+        m_tunnelInterfaces.Add(ipv4.Assign(ends));
+    }
+
+    NS_ASSERT(m_nNodes == 0 || m_interfaces.GetAddress(m_nNodes - 1) == WifiAddress(m_nNodes - 1));
+    NS_ASSERT(m_pairs.empty() || m_tunnelInterfaces.GetAddress(2 * m_pairs.size() - 1) == TunnelAddress(2 * m_pairs.size() - 1));
+}
+
+void WormholeScenario::InstallApplications()
+{
+    for (uint32_t k = 0; k < m_flows.size(); ++k)
+    {
+        // TCP connection from the source to a sink on its own port
+        uint16_t sinkPort = m_port + k;
+        Ptr<Node> source = m_nodes.Get(m_flows[k].m_source);
+        Ptr<Node> sink = m_nodes.Get(m_flows[k].m_sink);
+
+        Address sinkAddress(InetSocketAddress(WifiAddress(m_flows[k].m_sink), sinkPort));
+        PacketSinkHelper packetSinkHelper("ns3::TcpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), sinkPort));
+        ApplicationContainer sinkApps = packetSinkHelper.Install(sink);
+        sinkApps.Start(Seconds(0.));
+        sinkApps.Stop(Seconds(100.));
+
+        Ptr<Socket> ns3TcpSocket = Socket::CreateSocket(source, TcpSocketFactory::GetTypeId());
+        Ptr<MyApp> app = CreateObject<MyApp>();
+        app->Setup(ns3TcpSocket, sinkAddress, 1040, 5, DataRate("250Kbps"));
+        source->AddApplication(app);
+        app->SetStartTime(Seconds(40.));
+        app->SetStopTime(Seconds(100.));
+    }
+}
+
+bool WormholeScenario::IsMalicious(uint32_t node) const
+{
+    for (std::vector<Pair>::const_iterator i = m_pairs.begin(); i != m_pairs.end(); ++i)
+    {
+        if (i->m_first == node || i->m_second == node)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+Ipv4Address WormholeScenario::WifiAddress(uint32_t node) const
+{
+    return Ipv4Address(Ipv4Address("10.0.1.1").Get() + node);
+}
+
+Ipv4Address WormholeScenario::TunnelAddress(uint32_t end) const
+{
+    return Ipv4Address(Ipv4Address("10.1.0.1").Get() + 4 * (end / 2) + end % 2);
+}
+
+bool WormholeScenario::IsTrafficFlow(Ipv4Address source, Ipv4Address sink) const
+{
+    for (std::vector<Flow>::const_iterator i = m_flows.begin(); i != m_flows.end(); ++i)
+    {
+        if (WifiAddress(i->m_source) == source && WifiAddress(i->m_sink) == sink)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WormholeScenario::ParsePairs(const std::string &text, std::vector<Pair> &pairs)
+{
+    pairs.clear();
+    std::istringstream list(text);
+    std::string item;
+    while (std::getline(list, item, ','))
+    {
+        std::istringstream is(item);
+        Pair pair;
+        char dash = 0;
+        if (!(is >> pair.m_first >> dash >> pair.m_second) || dash != '-')
+        {
+            return false;
+        }
+        pairs.push_back(pair);
+    }
+    return true;
+}
+
+bool WormholeScenario::ParseFlows(const std::string &text, std::vector<Flow> &flows)
+{
+    std::vector<Pair> pairs;
+    if (!ParsePairs(text, pairs))
+    {
+        return false;
+    }
+    flows.clear();
+    for (std::vector<Pair>::const_iterator i = pairs.begin(); i != pairs.end(); ++i)
+    {
+        Flow flow = {i->m_first, i->m_second};
+        flows.push_back(flow);
+    }
+    return true;
+}
+
+bool WormholeScenario::ParsePlacement(const std::string &text, Placement &placement)
+{
+    if (text == "fixed")
+    {
+        placement = PLACEMENT_FIXED;
+    }
+    else if (text == "random")
+    {
+        placement = PLACEMENT_RANDOM;
+    }
+    else if (text == "farthest")
+    {
+        placement = PLACEMENT_FARTHEST;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
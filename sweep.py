@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+"""Run a parameter sweep of one of the scenario programs in parallel.
+
+Every scenario appends its results to text files in the current directory
+(task_a_flow_throughput.txt, TwormholeDesc.txt, manet-routing.output.csv,
+...), so running several at once in the same place corrupts them.  This
+driver runs each point of the grid in its own directory under the sweep
+output directory, keeps as many simulations running as there are cores,
+and merges the per-run text outputs at the end.
+
+The program is a built scenario executable (build the scenario once with
+./ns3 build, then point --program at the binary, e.g.
+build/scratch/ns3.35-newWormhole-default).  Every grid parameter is passed
+as --name=value, so any CommandLine value of the scenario or global value
+such as RngRun can be swept:
+
+    ./sweep.py --program build/scratch/ns3.35-taska-highrate-default \\
+        --param nWifi=20,40,80 --param nFlows=10,20 --param RngRun=1-5
+
+Attributes can be swept the same way.  newWormhole sets EnableWrmAttack
+on its wormhole pairs itself, so sweep its attack value instead, e.g.
+--param attack=false,true.
+
+Layout of the output directory:
+    runs/<id>/       working directory, stdout and stderr of run <id>
+    runs.csv         run id, parameters and exit status of every run
+    <file>           every .txt/.csv output, concatenated in run order, with
+                     every row prefixed by its run id (a "run" column in a
+                     .csv, "<id>\t" in a .txt) to join against runs.csv
+"""
+
+import argparse
+import concurrent.futures
+import csv
+import itertools
+import os
+import subprocess
+import sys
+
+# Outputs small enough to merge; traces and animations stay per run
+MERGED_SUFFIXES = (".txt", ".csv")
+RUN_LOGS = ("stdout.txt", "stderr.txt")
+RUN_INDEX = "runs.csv"
+
+
+def parse_values(text):
+    """Split "a,b,c" into values; "1-5" expands to an integer range."""
+    values = []
+    for item in text.split(","):
+        lo, sep, hi = item.partition("-")
+        if sep and lo.isdigit() and hi.isdigit():
+            values.extend(str(v) for v in range(int(lo), int(hi) + 1))
+        else:
+            values.append(item)
+    return values
+
+
+def parse_grid(params):
+    """Turn ["name=v1,v2", ...] into an ordered list of (name, values)."""
+    grid = []
+    for param in params:
+        name, sep, values = param.partition("=")
+        if not sep or not values:
+            raise SystemExit("bad --param %r, expected name=v1,v2,..." % param)
+        grid.append((name, parse_values(values)))
+    return grid
+
+
+def run_one(program, run_dir, point, timeout):
+    """Run one grid point in run_dir; return its exit status."""
+    os.makedirs(run_dir, exist_ok=True)
+    args = [program] + ["--%s=%s" % (name, value) for name, value in point]
+    with open(os.path.join(run_dir, "stdout.txt"), "w") as out, \
+            open(os.path.join(run_dir, "stderr.txt"), "w") as err:
+        try:
+            return subprocess.call(args, cwd=run_dir, stdout=out, stderr=err, timeout=timeout)
+        except subprocess.TimeoutExpired:
+            err.write("sweep: killed after %s s\n" % timeout)
+            return "timeout"
+
+
+def merge(out_dir, run_dirs):
+    """Concatenate same-named outputs of all runs, in run order.
+
+    Every row is prefixed with the id of the run that wrote it: a .csv gets
+    a leading "run" column, a .txt a leading "<id>\\t".  A .csv keeps its
+    first line once, as the header, when every run starts with the same one.
+    """
+    names = set()
+    for run_dir in run_dirs:
+        for name in os.listdir(run_dir):
+            if name.endswith(MERGED_SUFFIXES) and name not in RUN_LOGS:
+                names.add(name)
+    if RUN_INDEX in names:
+        print("sweep: not merging %s, it would overwrite the run index; see runs/*/%s"
+              % (RUN_INDEX, RUN_INDEX), file=sys.stderr)
+        names.remove(RUN_INDEX)
+    for name in sorted(names):
+        parts = []
+        for run_dir in run_dirs:
+            path = os.path.join(run_dir, name)
+            if os.path.exists(path):
+                with open(path) as part:
+                    parts.append((os.path.basename(run_dir), part.read().splitlines()))
+        csv_file = name.endswith(".csv")
+        firsts = set(lines[0] for _, lines in parts if lines)
+        header = firsts.pop() if csv_file and len(firsts) == 1 else None
+        separator = "," if csv_file else "\t"
+        with open(os.path.join(out_dir, name), "w") as merged:
+            if header is not None:
+                merged.write("run," + header + "\n")
+            for run, lines in parts:
+                if header is not None and lines:
+                    lines = lines[1:]
+                for line in lines:
+                    merged.write(run + separator + line + "\n" if line else "\n")
+    return sorted(names)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--program", required=True, help="scenario executable")
+    parser.add_argument("--param", action="append", default=[],
+                        help="name=v1,v2,... or name=lo-hi; repeat for every swept parameter")
+    parser.add_argument("--out", default="sweep-output", help="sweep output directory")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count() or 1,
+                        help="simulations run at once (default: number of cores)")
+    parser.add_argument("--timeout", type=float, default=None, help="seconds before a run is killed")
+    args = parser.parse_args()
+
+    program = os.path.abspath(args.program)
+    grid = parse_grid(args.param)
+    names = [name for name, _ in grid]
+    points = [list(zip(names, values)) for values in itertools.product(*[v for _, v in grid])]
+    width = len(str(max(len(points) - 1, 0)))
+    run_dirs = [os.path.abspath(os.path.join(args.out, "runs", str(i).zfill(width)))
+                for i in range(len(points))]
+    print("%d runs on %d workers" % (len(points), args.jobs))
+
+    status = [None] * len(points)
+    with concurrent.futures.ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        futures = {pool.submit(run_one, program, run_dirs[i], points[i], args.timeout): i
+                   for i in range(len(points))}
+        for done, future in enumerate(concurrent.futures.as_completed(futures), 1):
+            i = futures[future]
+            status[i] = future.result()
+            print("[%d/%d] run %s exited with %s" % (done, len(points), os.path.basename(run_dirs[i]), status[i]))
+
+    with open(os.path.join(args.out, RUN_INDEX), "w", newline="") as index:
+        writer = csv.writer(index)
+        writer.writerow(["run"] + names + ["status"])
+        for i, point in enumerate(points):
+            writer.writerow([os.path.basename(run_dirs[i])] + [v for _, v in point] + [status[i]])
+    merged = merge(args.out, run_dirs)
+    print("merged %s into %s" % (", ".join(merged) or "nothing", args.out))
+
+    failed = sum(1 for s in status if s != 0)
+    if failed:
+        print("%d runs failed, see runs.csv" % failed, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())